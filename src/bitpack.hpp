@@ -0,0 +1,229 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file bitpack.hpp
+ * @brief Tuples of booleans, small integers and enums packed into bitfields of declared widths.
+ */
+
+#ifndef FCPP_MIOSIX_BITPACK_H_
+#define FCPP_MIOSIX_BITPACK_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Number of bits needed to represent unsigned values up to a given one.
+constexpr size_t bit_width(unsigned long long x) {
+    return x == 0 ? 0 : 1 + bit_width(x >> 1);
+}
+
+//! @brief Declares a field of type `T` (boolean, integral or enum) packed into `B` bits.
+template <typename T, size_t B>
+struct bits {
+    static_assert(std::is_integral<T>::value or std::is_enum<T>::value, "only booleans, integers and enums can be packed");
+    static_assert(B > 0 and B <= 64, "fields must have between 1 and 64 bits");
+};
+
+
+//! @cond INTERNAL
+namespace details {
+    //! @brief Sum of bit widths.
+    constexpr size_t bit_sum() {
+        return 0;
+    }
+    template <typename... Ts>
+    constexpr size_t bit_sum(size_t x, Ts... xs) {
+        return x + bit_sum(xs...);
+    }
+
+    //! @brief The i-th type of a list.
+    template <size_t i, typename T, typename... Ts>
+    struct nth_type : nth_type<i-1, Ts...> {};
+    template <typename T, typename... Ts>
+    struct nth_type<0, T, Ts...> {
+        using type = T;
+    };
+
+    //! @brief Integral type underlying a packable type.
+    template <typename T, bool = std::is_enum<T>::value>
+    struct packed_integral {
+        using type = T;
+    };
+    template <typename T>
+    struct packed_integral<T, true> {
+        using type = std::underlying_type_t<T>;
+    };
+}
+//! @endcond
+
+
+/**
+ * @brief Tuple of fields declared as `bits<T, B>`, packed into the minimum number of bytes.
+ *
+ * Values not representable in the declared bits saturate to the closest representable value
+ * (signed fields use two's complement). Printing writes the fields as integers separated by
+ * spaces, as if they were separate columns, and serialisation writes the packed bytes.
+ */
+template <typename... Fs>
+class bitpack;
+
+//! @brief Tuple of fields packed into bitfields.
+template <typename... Ts, size_t... Bs>
+class bitpack<bits<Ts, Bs>...> {
+  public:
+    //! @brief Total number of bits.
+    static constexpr size_t bit_size = details::bit_sum(Bs...);
+    //! @brief Number of bytes.
+    static constexpr size_t byte_size = (bit_size + 7) / 8;
+    //! @brief Number of fields.
+    static constexpr size_t size = sizeof...(Ts);
+
+    //! @brief The type of the i-th field.
+    template <size_t i>
+    using type = typename details::nth_type<i, Ts...>::type;
+
+    //! @brief Default constructor (all fields zero).
+    bitpack() = default;
+
+    //! @brief Member constructor.
+    bitpack(Ts... xs) {
+        init(std::make_index_sequence<size>{}, xs...);
+    }
+
+    //! @brief The value of the i-th field.
+    template <size_t i>
+    type<i> get() const {
+        using I = typename details::packed_integral<type<i>>::type;
+        constexpr size_t b = width(i);
+        uint64_t x = take(offset(i), b);
+        if (std::is_signed<I>::value and b < 64 and (x >> (b - 1)) & 1) x |= ~uint64_t(0) << b;
+        return type<i>(I(x));
+    }
+
+    //! @brief Sets the value of the i-th field.
+    template <size_t i>
+    void set(type<i> x) {
+        put(offset(i), width(i), encode(x, width(i)));
+    }
+
+    //! @brief Equality operator.
+    bool operator==(bitpack const& o) const {
+        for (size_t i = 0; i < byte_size; ++i)
+            if (m_data[i] != o.m_data[i]) return false;
+        return true;
+    }
+
+    //! @brief Inequality operator.
+    bool operator!=(bitpack const& o) const {
+        return not (*this == o);
+    }
+
+    //! @brief Prints the fields as integers separated by spaces.
+    void print(std::ostream& o) const {
+        print(o, std::make_index_sequence<size>{});
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        for (size_t i = 0; i < byte_size; ++i) s & m_data[i];
+        return s;
+    }
+
+    //! @brief Serialises the content to a given output stream.
+    template <typename S>
+    S& serialize(S& s) const {
+        for (size_t i = 0; i < byte_size; ++i) s << m_data[i];
+        return s;
+    }
+
+  private:
+    //! @brief The width of the i-th field.
+    static constexpr size_t width(size_t i) {
+        constexpr size_t w[] = {Bs...};
+        return w[i];
+    }
+
+    //! @brief The offset in bits of the i-th field.
+    static constexpr size_t offset(size_t i) {
+        constexpr size_t w[] = {Bs...};
+        size_t off = 0;
+        for (size_t j = 0; j < i; ++j) off += w[j];
+        return off;
+    }
+
+    //! @brief Encodes a value into a given number of bits, saturating it.
+    template <typename T>
+    static uint64_t encode(T v, size_t b) {
+        using I = typename details::packed_integral<T>::type;
+        I x = I(v);
+        if (std::is_signed<I>::value) {
+            int64_t hi = b >= 64 ? INT64_MAX : (int64_t(1) << (b - 1)) - 1;
+            int64_t y = int64_t(x) > hi ? hi : int64_t(x) < -hi-1 ? -hi-1 : int64_t(x);
+            return uint64_t(y) & mask(b);
+        }
+        uint64_t y = uint64_t(x);
+        return y > mask(b) ? mask(b) : y;
+    }
+
+    //! @brief Mask of the lowest `b` bits.
+    static constexpr uint64_t mask(size_t b) {
+        return b >= 64 ? ~uint64_t(0) : (uint64_t(1) << b) - 1;
+    }
+
+    //! @brief Writes `b` bits at a given bit offset.
+    void put(size_t off, size_t b, uint64_t x) {
+        for (size_t j = 0; j < b; ++j, ++off) {
+            uint8_t bit = uint8_t(1) << (off % 8);
+            if ((x >> j) & 1) m_data[off / 8] |= bit;
+            else m_data[off / 8] &= ~bit;
+        }
+    }
+
+    //! @brief Reads `b` bits at a given bit offset.
+    uint64_t take(size_t off, size_t b) const {
+        uint64_t x = 0;
+        for (size_t j = 0; j < b; ++j, ++off)
+            x |= uint64_t((m_data[off / 8] >> (off % 8)) & 1) << j;
+        return x;
+    }
+
+    //! @brief Sets all the fields.
+    template <size_t... is>
+    void init(std::index_sequence<is...>, Ts... xs) {
+        int dummy[] = {(set<is>(xs), 0)...};
+        (void)dummy;
+    }
+
+    //! @brief Prints the fields as integers separated by spaces.
+    template <size_t... is>
+    void print(std::ostream& o, std::index_sequence<is...>) const {
+        int dummy[] = {(o << (is ? " " : "") << +static_cast<typename details::packed_integral<type<is>>::type>(get<is>()), 0)...};
+        (void)dummy;
+    }
+
+    //! @brief The packed fields.
+    uint8_t m_data[byte_size] = {};
+};
+
+//! @brief Printing a bitpack.
+template <typename... Fs>
+std::ostream& operator<<(std::ostream& o, bitpack<Fs...> const& b) {
+    b.print(o);
+    return o;
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_BITPACK_H_
@@ -0,0 +1,136 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+//! @brief A logged measurement.
+struct sample {
+    //! @brief Distance in meters.
+    double distance;
+    //! @brief Received power in dBm.
+    double rssi;
+    //! @brief Index of the sender board (negative if unknown).
+    int sender;
+    //! @brief Index of the receiver board (negative if unknown).
+    int receiver;
+};
+
+//! @brief Solves a linear system by gaussian elimination with partial pivoting, returning whether it is non-singular.
+bool solve(std::vector<std::vector<double>>& a, std::vector<double>& b) {
+    size_t n = b.size();
+    for (size_t c = 0; c < n; ++c) {
+        size_t p = c;
+        for (size_t r = c+1; r < n; ++r)
+            if (std::abs(a[r][c]) > std::abs(a[p][c])) p = r;
+        if (std::abs(a[p][c]) < 1e-12) return false;
+        std::swap(a[c], a[p]);
+        std::swap(b[c], b[p]);
+        for (size_t r = 0; r < n; ++r) {
+            if (r == c) continue;
+            double f = a[r][c] / a[c][c];
+            for (size_t k = c; k < n; ++k) a[r][k] -= f * a[c][k];
+            b[r] -= f * b[c];
+        }
+    }
+    for (size_t c = 0; c < n; ++c) b[c] /= a[c][c];
+    return true;
+}
+
+
+/**
+ * @brief Fits the path loss model of `rssi_model.hpp` from logged measurements (in a file or the standard input).
+ *
+ * Every line holds a distance in meters and a received power in dBm, optionally followed by
+ * the UIDs of the sender and receiver boards (lines starting with `#` are ignored). Received power
+ * is fitted by least squares as `rssi0 - 10 * exponent * log10(distance) + offset(sender) + offset(receiver)`,
+ * with offsets summing up to zero, and the resulting compilation flags are printed.
+ */
+int main(int argc, char** argv) {
+    std::ifstream fin;
+    if (argc > 1) {
+        fin.open(argv[1]);
+        if (not fin) {
+            std::cerr << "cannot open " << argv[1] << std::endl;
+            return 1;
+        }
+    }
+    std::istream& in = argc > 1 ? fin : std::cin;
+    std::vector<sample> samples;
+    std::map<uint64_t, int> boards;
+    std::vector<uint64_t> uids;
+    auto board = [&](uint64_t uid) {
+        auto it = boards.find(uid);
+        if (it != boards.end()) return it->second;
+        uids.push_back(uid);
+        return boards[uid] = int(uids.size()) - 1;
+    };
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() or line[0] == '#') continue;
+        std::stringstream ss(line);
+        sample s{0, 0, -1, -1};
+        uint64_t sender, receiver;
+        if (not (ss >> s.distance >> s.rssi) or s.distance <= 0) continue;
+        if (ss >> sender >> receiver) {
+            s.sender = board(sender);
+            s.receiver = board(receiver);
+        }
+        samples.push_back(s);
+    }
+    // unknowns: rssi0, exponent, board offsets
+    size_t n = 2 + uids.size();
+    if (samples.size() < n) {
+        std::cerr << "not enough samples (" << samples.size() << "/" << n << ")" << std::endl;
+        return 1;
+    }
+    std::vector<std::vector<double>> a(n, std::vector<double>(n, 0));
+    std::vector<double> b(n, 0);
+    auto add_row = [&](std::vector<double> const& row, double y) {
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) a[i][j] += row[i] * row[j];
+            b[i] += row[i] * y;
+        }
+    };
+    for (sample const& s : samples) {
+        std::vector<double> row(n, 0);
+        row[0] = 1;
+        row[1] = -10 * std::log10(s.distance);
+        if (s.sender >= 0) row[2 + s.sender] += 1;
+        if (s.receiver >= 0) row[2 + s.receiver] += 1;
+        add_row(row, s.rssi);
+    }
+    if (uids.size() > 0) {
+        std::vector<double> row(n, 0);
+        for (size_t i = 2; i < n; ++i) row[i] = samples.size();
+        add_row(row, 0);
+    }
+    if (not solve(a, b)) {
+        std::cerr << "singular system: distances should vary" << std::endl;
+        return 1;
+    }
+    double sq = 0;
+    for (sample const& s : samples) {
+        double r = b[0] - 10 * b[1] * std::log10(s.distance);
+        if (s.sender >= 0) r += b[2 + s.sender];
+        if (s.receiver >= 0) r += b[2 + s.receiver];
+        sq += (s.rssi - r) * (s.rssi - r);
+    }
+    double spread = std::sqrt(sq / std::max<size_t>(samples.size() - n, 1));
+    std::cout << "# " << samples.size() << " samples from " << uids.size() << " boards" << std::endl;
+    std::cout << "-DFCPP_MIOSIX_RSSI_AT_1M=" << b[0] << " -DFCPP_MIOSIX_PATH_LOSS_EXPONENT=" << b[1] << " -DFCPP_MIOSIX_RSSI_SPREAD=" << spread;
+    if (uids.size() > 0) {
+        std::cout << " '-DFCPP_MIOSIX_RSSI_OFFSETS=";
+        for (size_t i = 0; i < uids.size(); ++i)
+            std::cout << (i ? "," : "") << "{" << uids[i] << "," << b[2+i] << "}";
+        std::cout << "'";
+    }
+    std::cout << std::endl;
+    return 0;
+}
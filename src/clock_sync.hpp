@@ -0,0 +1,213 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file clock_sync.hpp
+ * @brief Estimate of the network-wide global clock, shared between the aggregate program and the driver.
+ */
+
+#ifndef FCPP_MIOSIX_CLOCK_SYNC_H_
+#define FCPP_MIOSIX_CLOCK_SYNC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <mutex>
+
+#include "lib/settings.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+/**
+ * @brief Mapping between the local clock and the global clock.
+ *
+ * The global clock is the clock of the device with the lowest UID (the root), propagated
+ * through the transmit timestamps embedded in messages. Samples pairing the hardware
+ * reception time of a message with the global transmit time it carries are fitted by
+ * linear regression, compensating both offset and skew. Devices not (yet) following a
+ * root use the coarser global time provided by the aggregate program through `update`.
+ *
+ * As in FTSP, the root advances a sequence number with every message it sends, and the
+ * other devices forward the latest sequence number they heard together with the root.
+ * Only samples carrying a newer sequence number are used, and the root is considered lost
+ * if no newer one arrives for `root_timeout`: once the root dies, devices still advertising
+ * it cannot keep each other following it, nor bring back the devices which already gave it up
+ * (the last root lost is ignored until it sends a newer sequence number). All the members are thread-safe, as samples come
+ * from the radio thread.
+ */
+class clock_sync {
+  public:
+    //! @brief Number of samples in the regression table.
+    static constexpr size_t max_samples = 8;
+
+    //! @brief Time without new sequence numbers from the root after which it is considered lost.
+    static constexpr int root_timeout = 30;
+
+    //! @brief Sets the UID of the device.
+    void uid(device_t id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_uid = m_root = m_lost = id;
+    }
+
+    //! @brief Whether the global clock has ever been estimated.
+    bool synced() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_synced;
+    }
+
+    //! @brief The device whose clock is followed.
+    device_t root() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_root;
+    }
+
+    /**
+     * @brief The root and its latest sequence number, to be carried by an outgoing message.
+     *
+     * The sequence number is advanced if the device is the root.
+     */
+    void stamp(device_t& root, uint16_t& seq) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_root == m_uid) ++m_seq;
+        root = m_root;
+        seq = m_seq;
+    }
+
+    //! @brief The estimated relative skew of the global clock with respect to the local clock.
+    real_t skew() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_skew;
+    }
+
+    //! @brief Updates the mapping given corresponding local and global times from the aggregate program.
+    void update(times_t local, times_t global) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_root != m_uid and local - m_last > root_timeout) become_root(local);
+        if (m_timestamped) return;
+        m_offset = global - local;
+        m_synced = true;
+    }
+
+    //! @brief Updates the mapping with a message received at a local time, sent at a global time by a device following a root with a sequence number.
+    void sample(times_t local, times_t global, device_t root, uint16_t seq) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_root != m_uid and local - m_last > root_timeout) become_root(local);
+        if (root > m_root or root == m_uid) return;
+        if (root == m_lost and int16_t(seq - m_lost_seq) <= 0) return;
+        if (root < m_root) {
+            m_root = root;
+            m_count = m_next = 0;
+        } else if (int16_t(seq - m_seq) <= 0) return;
+        m_seq = seq;
+        m_timestamped = m_synced = true;
+        m_last = local;
+        m_local[m_next] = local;
+        m_delta[m_next] = global - local;
+        m_next = (m_next + 1) % max_samples;
+        if (m_count < max_samples) ++m_count;
+        regression();
+    }
+
+    //! @brief The global time corresponding to a local time.
+    times_t global(times_t local) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return to_global(local);
+    }
+
+    //! @brief The local time corresponding to a global time.
+    times_t local(times_t global) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return (global - m_offset + m_skew * m_mean) / (1 + m_skew);
+    }
+
+  private:
+    //! @brief The global time corresponding to a local time (with the mutex held).
+    times_t to_global(times_t local) const {
+        return local + m_offset + m_skew * (local - m_mean);
+    }
+
+    //! @brief Starts following the own clock, without discontinuities.
+    void become_root(times_t local) {
+        m_lost = m_root;
+        m_lost_seq = m_seq;
+        m_offset = to_global(local) - local;
+        m_skew = 0;
+        m_mean = 0;
+        m_root = m_uid;
+        m_count = m_next = 0;
+    }
+
+    //! @brief Fits the samples by least squares.
+    void regression() {
+        times_t ml = 0, md = 0;
+        for (size_t i = 0; i < m_count; ++i) {
+            ml += m_local[i];
+            md += m_delta[i];
+        }
+        ml /= m_count;
+        md /= m_count;
+        times_t num = 0, den = 0;
+        for (size_t i = 0; i < m_count; ++i) {
+            num += (m_local[i] - ml) * (m_delta[i] - md);
+            den += (m_local[i] - ml) * (m_local[i] - ml);
+        }
+        m_mean = ml;
+        m_offset = md;
+        m_skew = den > 0 ? real_t(num / den) : 0;
+    }
+
+    //! @brief Mutex guarding all the members.
+    mutable std::mutex m_mutex;
+    //! @brief The UID of the device.
+    device_t m_uid = 0;
+    //! @brief The device whose clock is followed.
+    device_t m_root = 0;
+    //! @brief Whether the global clock has ever been estimated.
+    bool m_synced = false;
+    //! @brief Whether the global clock has ever been estimated from message timestamps.
+    bool m_timestamped = false;
+    //! @brief Difference between global and local time at the local time `m_mean`.
+    times_t m_offset = 0;
+    //! @brief Reference local time for skew compensation.
+    times_t m_mean = 0;
+    //! @brief Relative skew of the global clock.
+    real_t m_skew = 0;
+    //! @brief Latest sequence number of the root.
+    uint16_t m_seq = 0;
+    //! @brief The last root lost (the own UID if none).
+    device_t m_lost = 0;
+    //! @brief Latest sequence number of the last root lost.
+    uint16_t m_lost_seq = 0;
+    //! @brief Local time of the last sample (the last new sequence number of the root).
+    times_t m_last = 0;
+    //! @brief Number of samples in the table.
+    size_t m_count = 0;
+    //! @brief Position of the next sample in the table.
+    size_t m_next = 0;
+    //! @brief Local times of the samples.
+    times_t m_local[max_samples];
+    //! @brief Differences between global and local times of the samples.
+    times_t m_delta[max_samples];
+};
+
+//! @brief The global clock estimate of the device.
+inline clock_sync& global_clock() {
+    static clock_sync c;
+    return c;
+}
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_CLOCK_SYNC_H_
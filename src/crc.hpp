@@ -0,0 +1,48 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file crc.hpp
+ * @brief Checksums for data stored or transferred outside of radio frames.
+ */
+
+#ifndef FCPP_MIOSIX_CRC_H_
+#define FCPP_MIOSIX_CRC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+/**
+ * @brief CRC-32 (IEEE 802.3) of a sequence of bytes.
+ *
+ * Computed bitwise to avoid a lookup table in flash. The checksum of data split in parts
+ * is obtained by passing the checksum of the previous parts as `crc`.
+ */
+inline uint32_t crc32(void const* data, size_t size, uint32_t crc = 0) {
+    uint8_t const* p = static_cast<uint8_t const*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= p[i];
+        for (int j = 0; j < 8; ++j)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_CRC_H_
@@ -0,0 +1,278 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file delta_encoding.hpp
+ * @brief Encoding of messages as differences from a periodically broadcast keyframe.
+ */
+
+#ifndef FCPP_MIOSIX_DELTA_ENCODING_H_
+#define FCPP_MIOSIX_DELTA_ENCODING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "lib/settings.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+//! @brief Encodings of a message.
+enum class message_encoding : uint8_t {
+    raw,        //!< the message as is
+    keyframe,   //!< keyframe identifier, followed by the message as is
+    delta       //!< keyframe identifier and message size, followed by the segments differing from the keyframe
+};
+
+//! @brief Counters of the delta encoding activity (updated by the radio thread).
+struct delta_stats {
+    //! @brief Keyframes sent.
+    std::atomic<uint32_t> keyframes{0};
+    //! @brief Deltas sent.
+    std::atomic<uint32_t> deltas{0};
+    //! @brief Total size of the messages sent, before encoding.
+    std::atomic<uint32_t> original_bytes{0};
+    //! @brief Total size of the messages sent, after encoding.
+    std::atomic<uint32_t> encoded_bytes{0};
+    //! @brief Deltas received whose keyframe was missing.
+    std::atomic<uint32_t> unresolved{0};
+};
+
+//! @brief The delta encoding counters since boot.
+inline delta_stats& delta_counters() {
+    static delta_stats s;
+    return s;
+}
+
+
+//! @cond INTERNAL
+namespace details {
+    //! @brief Writes a variable-length unsigned integer, returning the number of bytes written.
+    inline size_t write_varint(char* p, size_t x) {
+        size_t i = 0;
+        for (; x >= 128; x >>= 7) p[i++] = char(x | 128);
+        p[i++] = char(x);
+        return i;
+    }
+
+    //! @brief Reads a variable-length unsigned integer, returning the number of bytes read (zero on error).
+    inline size_t read_varint(char const* p, size_t n, size_t& x) {
+        x = 0;
+        for (size_t i = 0; i < n and i < 4; ++i) {
+            x |= size_t(p[i] & 127) << (7*i);
+            if ((p[i] & 128) == 0) return i+1;
+        }
+        return 0;
+    }
+}
+//! @endcond
+
+
+/**
+ * @brief Encodes outgoing messages of up to `max_size` bytes with respect to the last keyframe.
+ *
+ * A keyframe is sent every `period` messages, or whenever a delta would not be shorter.
+ * Deltas refer to the last keyframe rather than to the previous message, so that a
+ * neighbour missing a delta can still decode the following ones.
+ */
+template <size_t max_size>
+class delta_encoder {
+  public:
+    //! @brief Constructor given the keyframe period (zero to disable encoding).
+    delta_encoder(uint8_t period) : m_period(period) {}
+
+    /**
+     * @brief Encodes a message.
+     *
+     * Sets `out` and `out_size` to the encoded message, which stays valid until the next call
+     * (and coincides with the input for raw messages).
+     */
+    message_encoding encode(char const* msg, size_t size, char const*& out, size_t& out_size) {
+        out = msg;
+        out_size = size;
+        if (m_period == 0 or size > max_size) return message_encoding::raw;
+        out = m_out;
+        delta_counters().original_bytes.fetch_add(size, std::memory_order_relaxed);
+        if (m_since + 1 < m_period and delta(msg, size, m_out, out_size)) {
+            ++m_since;
+            delta_counters().deltas.fetch_add(1, std::memory_order_relaxed);
+            delta_counters().encoded_bytes.fetch_add(out_size, std::memory_order_relaxed);
+            return message_encoding::delta;
+        }
+        m_since = 0;
+        ++m_id;
+        memcpy(m_key, msg, size);
+        m_key_size = size;
+        m_out[0] = char(m_id);
+        memcpy(m_out + 1, msg, size);
+        out_size = size + 1;
+        delta_counters().keyframes.fetch_add(1, std::memory_order_relaxed);
+        delta_counters().encoded_bytes.fetch_add(out_size, std::memory_order_relaxed);
+        return message_encoding::keyframe;
+    }
+
+  private:
+    //! @brief Minimum number of equal bytes splitting two segments of differences.
+    static constexpr size_t min_gap = 3;
+
+    //! @brief Writes the delta of a message, returning false if it is not shorter than the message.
+    bool delta(char const* msg, size_t size, char* out, size_t& out_size) const {
+        size_t limit = size + 1;
+        size_t p = 0, prev = 0;
+        char tmp[8];
+        auto put = [&](char const* data, size_t n) {
+            if (p + n >= limit) return false;
+            memcpy(out + p, data, n);
+            p += n;
+            return true;
+        };
+        tmp[0] = char(m_id);
+        if (not put(tmp, 1 + details::write_varint(tmp + 1, size))) return false;
+        for (size_t i = 0; i < size; ) {
+            if (i < m_key_size and msg[i] == m_key[i]) {
+                ++i;
+                continue;
+            }
+            size_t end = i + 1;
+            for (size_t j = end; j < size and j < end + min_gap; ++j)
+                if (j >= m_key_size or msg[j] != m_key[j]) end = j + 1;
+            size_t n = details::write_varint(tmp, i - prev);
+            n += details::write_varint(tmp + n, end - i);
+            if (not put(tmp, n) or not put(msg + i, end - i)) return false;
+            prev = i = end;
+        }
+        out_size = p;
+        return true;
+    }
+
+    //! @brief Number of messages between keyframes.
+    uint8_t m_period;
+    //! @brief Number of deltas sent since the last keyframe.
+    uint8_t m_since = 0;
+    //! @brief Identifier of the last keyframe.
+    uint8_t m_id = 0;
+    //! @brief Size of the last keyframe.
+    size_t m_key_size = 0;
+    //! @brief The last keyframe.
+    char m_key[max_size];
+    //! @brief The last encoded message.
+    char m_out[max_size + 1];
+};
+
+
+/**
+ * @brief Decodes incoming messages of up to `max_size` bytes from up to `slots` neighbours.
+ *
+ * The last keyframe of every neighbour is cached, evicting the least recently used one
+ * when room is needed for a new neighbour.
+ */
+template <size_t max_size, size_t slots>
+class delta_decoder {
+  public:
+    /**
+     * @brief Decodes a message from a device.
+     *
+     * @return Whether the message could be decoded: if so, `out` and `out_size` are set
+     *         to its content, which stays valid until the next call.
+     */
+    bool decode(device_t device, message_encoding e, char const* in, size_t n, char const*& out, size_t& out_size) {
+        if (e == message_encoding::raw) {
+            out = in;
+            out_size = n;
+            return true;
+        }
+        if (n < 1) return false;
+        ++m_clock;
+        uint8_t id = in[0];
+        if (e == message_encoding::keyframe) {
+            if (n - 1 > max_size) return false;
+            entry& k = find(device);
+            k.id = id;
+            k.size = n - 1;
+            k.last = m_clock;
+            memcpy(k.data, in + 1, k.size);
+            out = k.data;
+            out_size = k.size;
+            return true;
+        }
+        entry* k = nullptr;
+        for (entry& x : m_entries)
+            if (x.size != npos and x.device == device and x.id == id) k = &x;
+        size_t size;
+        size_t p = 1 + details::read_varint(in + 1, n - 1, size);
+        if (k == nullptr or p == 1 or size > max_size) {
+            delta_counters().unresolved.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        k->last = m_clock;
+        memcpy(m_scratch, k->data, k->size < size ? k->size : size);
+        for (size_t i = 0; p < n; ) {
+            size_t skip, len, r1, r2;
+            r1 = details::read_varint(in + p, n - p, skip);
+            if (r1 == 0) return false;
+            r2 = details::read_varint(in + p + r1, n - p - r1, len);
+            if (r2 == 0) return false;
+            p += r1 + r2;
+            i += skip;
+            if (i + len > size or p + len > n) return false;
+            memcpy(m_scratch + i, in + p, len);
+            p += len;
+            i += len;
+        }
+        out = m_scratch;
+        out_size = size;
+        return true;
+    }
+
+  private:
+    //! @brief Marker of unused entries.
+    static constexpr size_t npos = size_t(-1);
+
+    //! @brief The last keyframe received from a neighbour.
+    struct entry {
+        //! @brief The neighbour.
+        device_t device;
+        //! @brief The keyframe identifier.
+        uint8_t id;
+        //! @brief The keyframe size (npos if unused).
+        size_t size = npos;
+        //! @brief Last time the entry has been used.
+        uint32_t last;
+        //! @brief The keyframe.
+        char data[max_size];
+    };
+
+    //! @brief The entry of a device, possibly replacing the least recently used one.
+    entry& find(device_t device) {
+        entry* res = &m_entries[0];
+        for (entry& x : m_entries) {
+            if (x.size != npos and x.device == device) return x;
+            if (res->size != npos and (x.size == npos or x.last < res->last)) res = &x;
+        }
+        res->device = device;
+        return *res;
+    }
+
+    //! @brief Counter used for recency of entries.
+    uint32_t m_clock = 0;
+    //! @brief The cached keyframes.
+    entry m_entries[slots];
+    //! @brief Buffer for decoded deltas.
+    char m_scratch[max_size];
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_DELTA_ENCODING_H_
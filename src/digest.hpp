@@ -0,0 +1,179 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file digest.hpp
+ * @brief Fixed-size, time-windowed probabilistic digest of a set of devices.
+ */
+
+#ifndef FCPP_MIOSIX_DIGEST_H_
+#define FCPP_MIOSIX_DIGEST_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <cmath>
+#include <ostream>
+
+#include "lib/settings.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Natural logarithm of a positive number, usable in constant expressions.
+constexpr double bloom_log(double x) {
+    int e = 0;
+    while (x >= 2) x /= 2, ++e;
+    while (x < 1) x *= 2, --e;
+    double y = (x - 1) / (x + 1), t = y, s = 0;
+    for (int i = 1; i < 40; i += 2, t *= y * y) s += t / i;
+    return 2 * s + e * 0.6931471805599453;
+}
+
+//! @brief Number of bits (a multiple of 8) of a Bloom filter holding `n` elements with false positive rate `p`.
+constexpr size_t bloom_bits(size_t n, double p) {
+    double b = -double(n) * bloom_log(p) / (0.6931471805599453 * 0.6931471805599453);
+    size_t bits = size_t(b) + (size_t(b) < b);
+    return (bits + 7) / 8 * 8;
+}
+
+//! @brief Optimal number of hash functions of a Bloom filter with `m` bits holding `n` elements.
+constexpr size_t bloom_hashes(size_t m, size_t n) {
+    size_t k = size_t(double(m) / n * 0.6931471805599453 + 0.5);
+    return k > 0 ? k : 1;
+}
+
+
+/**
+ * @brief Set of devices split into `E` epochs, each represented by a Bloom filter of `M` bits and `K` hashes.
+ *
+ * A digest refers to a current epoch (a coarse timestamp): devices are inserted into it,
+ * and the `E-1` previous epochs hold devices inserted earlier. Merging a digest with an older
+ * current epoch aligns the epochs, dropping those falling out of the window, so that devices
+ * expire `E` epochs after their last insertion while the size stays constant. Membership
+ * tests may report false positives (never false negatives), whose rate is estimated from the
+ * fraction of bits set.
+ */
+template <size_t E, size_t M, size_t K>
+class epoch_bloom {
+    static_assert(E > 0 and M > 0 and M % 8 == 0, "epochs and bits must be positive, with bits a multiple of 8");
+
+  public:
+    //! @brief Constructor given the current epoch.
+    epoch_bloom(uint16_t epoch = 0) : m_epoch(epoch), m_bits{} {}
+
+    //! @brief The current epoch.
+    uint16_t epoch() const {
+        return m_epoch;
+    }
+
+    //! @brief Inserts a device in the current epoch.
+    void insert(device_t d) {
+        uint32_t h1, h2;
+        hash(d, h1, h2);
+        for (size_t i = 0; i < K; ++i) {
+            uint32_t b = (h1 + i * h2) % M;
+            m_bits[0][b / 8] |= uint8_t(1) << (b % 8);
+        }
+    }
+
+    //! @brief Whether a device may have been inserted in some epoch.
+    bool count(device_t d) const {
+        uint32_t h1, h2;
+        hash(d, h1, h2);
+        for (size_t e = 0; e < E; ++e) {
+            bool found = true;
+            for (size_t i = 0; i < K and found; ++i) {
+                uint32_t b = (h1 + i * h2) % M;
+                found = (m_bits[e][b / 8] >> (b % 8)) & 1;
+            }
+            if (found) return true;
+        }
+        return false;
+    }
+
+    //! @brief Adds the devices of another digest, in the epochs still within the window.
+    void merge(epoch_bloom const& o) {
+        int shift = int16_t(m_epoch - o.m_epoch);
+        for (size_t e = 0; e < E; ++e) {
+            int l = shift + int(e);
+            if (l < 0 or l >= int(E)) continue;
+            for (size_t i = 0; i < M / 8; ++i) m_bits[l][i] |= o.m_bits[e][i];
+        }
+    }
+
+    //! @brief Estimated probability that a device not inserted is reported as present.
+    real_t false_positive_rate() const {
+        real_t negative = 1;
+        for (size_t e = 0; e < E; ++e) {
+            size_t set = 0;
+            for (size_t i = 0; i < M / 8; ++i)
+                for (uint8_t b = m_bits[e][i]; b; b &= b - 1) ++set;
+            using std::pow;
+            negative *= 1 - pow(real_t(set) / M, real_t(K));
+        }
+        return 1 - negative;
+    }
+
+    //! @brief Equality operator.
+    bool operator==(epoch_bloom const& o) const {
+        if (m_epoch != o.m_epoch) return false;
+        for (size_t e = 0; e < E; ++e)
+            for (size_t i = 0; i < M / 8; ++i)
+                if (m_bits[e][i] != o.m_bits[e][i]) return false;
+        return true;
+    }
+
+    //! @brief Inequality operator.
+    bool operator!=(epoch_bloom const& o) const {
+        return not (*this == o);
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        s & m_epoch;
+        for (size_t e = 0; e < E; ++e)
+            for (size_t i = 0; i < M / 8; ++i) s & m_bits[e][i];
+        return s;
+    }
+
+    //! @brief Serialises the content to a given output stream.
+    template <typename S>
+    S& serialize(S& s) const {
+        s << m_epoch;
+        for (size_t e = 0; e < E; ++e)
+            for (size_t i = 0; i < M / 8; ++i) s << m_bits[e][i];
+        return s;
+    }
+
+  private:
+    //! @brief Two independent hashes of a device, for double hashing.
+    static void hash(device_t d, uint32_t& h1, uint32_t& h2) {
+        uint32_t x = uint32_t(d);
+        x = (x ^ (x >> 16)) * 0x45d9f3bu;
+        x = (x ^ (x >> 16)) * 0x45d9f3bu;
+        h1 = x ^ (x >> 16);
+        x = h1 * 0x9e3779b1u;
+        h2 = (x ^ (x >> 15)) | 1;
+    }
+
+    //! @brief The current epoch.
+    uint16_t m_epoch;
+    //! @brief The filters, from the current epoch backwards.
+    uint8_t m_bits[E][M / 8];
+};
+
+//! @brief Printing a digest, as its current epoch and estimated false positive rate.
+template <size_t E, size_t M, size_t K>
+std::ostream& operator<<(std::ostream& o, epoch_bloom<E,M,K> const& d) {
+    return o << "{epoch:" << d.epoch() << ", fp:" << d.false_positive_rate() << "}";
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_DIGEST_H_
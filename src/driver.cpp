@@ -48,9 +48,9 @@ void activity() {}
 const char transceiver::panHeader[transceiver::panHeaderSize] = {
     0x41, //frame type 0b001 (data), intra pan
     0x08, //no source addressing, short destination addressing
-    0x00, //seq no
-    0xaa, 0xbb, //pan ID (hardcoded)
-    0xff, 0xff, //destination addr (broadcast)
+    0x00, //seq no (initial, incremented at every frame sent)
+    char(0xaa), char(0xbb), //pan ID (hardcoded)
+    char(0xff), char(0xff), //destination addr (broadcast)
 };
 
 }
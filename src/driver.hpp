@@ -12,11 +12,16 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdarg>
+#include <cstdio>
 #include <exception>
+#include <memory>
 #include <random>
-#include <thread>
 #include <vector>
 
 #include "lib/settings.hpp"
@@ -26,8 +31,125 @@
 #include "miosix.h"
 #include "interfaces-impl/transceiver.h"
 
-#define DBG_PRINT_SUCCESSFUL_CALLS
+#include "clock_sync.hpp"
+#include "delta_encoding.hpp"
+#include "fragmentation.hpp"
+#include "link_table.hpp"
+#include "pool.hpp"
+#include "quiescence.hpp"
+#include "radio_trace.hpp"
+#include "spsc_queue.hpp"
+#include "streamlogger.hpp"
+#include "tdma.hpp"
+
+#ifndef FCPP_MIOSIX_HOST
 #define DBG_TRANSCEIVER_ACTIVITY_LED
+#endif
+
+//! @brief Number of frames that can be received before being consumed (defaults to twice the maximum degree).
+#ifndef FCPP_MIOSIX_RECEIVE_SLOTS
+#ifdef DEGREE
+#define FCPP_MIOSIX_RECEIVE_SLOTS (2*DEGREE)
+#else
+#define FCPP_MIOSIX_RECEIVE_SLOTS 16
+#endif
+#endif
+
+//! @brief Number of bytes of driver messages retained until they are printed.
+#ifndef FCPP_MIOSIX_LOG_SIZE
+#define FCPP_MIOSIX_LOG_SIZE 1024
+#endif
+
+//! @brief Maximum number of frames a message can be split into.
+#ifndef FCPP_MIOSIX_MAX_FRAGMENTS
+#define FCPP_MIOSIX_MAX_FRAGMENTS 8
+#endif
+
+//! @brief Maximum number of fragmented messages that can be reassembled at the same time.
+#ifndef FCPP_MIOSIX_REASSEMBLY_SLOTS
+#define FCPP_MIOSIX_REASSEMBLY_SLOTS 4
+#endif
+
+//! @brief Default number of messages between keyframes in delta encoding (zero to disable it).
+#ifndef FCPP_MIOSIX_KEYFRAME_PERIOD
+#define FCPP_MIOSIX_KEYFRAME_PERIOD 4
+#endif
+
+//! @brief Maximum size of messages to be delta encoded.
+#ifndef FCPP_MIOSIX_DELTA_SIZE
+#define FCPP_MIOSIX_DELTA_SIZE 128
+#endif
+
+//! @brief Maximum number of neighbours whose keyframes are cached (defaults to the maximum degree).
+#ifndef FCPP_MIOSIX_DELTA_SLOTS
+#ifdef DEGREE
+#define FCPP_MIOSIX_DELTA_SLOTS DEGREE
+#else
+#define FCPP_MIOSIX_DELTA_SLOTS 8
+#endif
+#endif
+
+//! @brief Whether frames carry the global transmit time, for clock synchronisation.
+#ifndef FCPP_MIOSIX_TIMESTAMPS
+#define FCPP_MIOSIX_TIMESTAMPS true
+#endif
+
+//! @brief Default number of TDMA slots in a period (zero for contention-based access).
+#ifndef FCPP_MIOSIX_TDMA_SLOTS
+#define FCPP_MIOSIX_TDMA_SLOTS 0
+#endif
+
+//! @brief Default TDMA period in nanoseconds (defaults to the round period).
+#ifndef FCPP_MIOSIX_TDMA_PERIOD
+#ifdef ROUND_PERIOD
+#define FCPP_MIOSIX_TDMA_PERIOD (ROUND_PERIOD * 1000000000LL)
+#else
+#define FCPP_MIOSIX_TDMA_PERIOD 1000000000LL
+#endif
+#endif
+
+//! @brief Default number of TDMA periods between discovery periods, in which every slot is listened.
+#ifndef FCPP_MIOSIX_TDMA_DISCOVERY
+#define FCPP_MIOSIX_TDMA_DISCOVERY 10
+#endif
+
+//! @brief Default number of unchanged messages between heartbeats (zero to always send messages).
+#ifndef FCPP_MIOSIX_HEARTBEAT_PERIOD
+#ifdef HEARTBEAT_PERIOD
+#define FCPP_MIOSIX_HEARTBEAT_PERIOD HEARTBEAT_PERIOD
+#else
+#define FCPP_MIOSIX_HEARTBEAT_PERIOD 0
+#endif
+#endif
+
+//! @brief Default number of unchanged messages after which a message is sent again anyway (zero for never).
+#ifndef FCPP_MIOSIX_REFRESH_PERIOD
+#ifdef REFRESH_PERIOD
+#define FCPP_MIOSIX_REFRESH_PERIOD REFRESH_PERIOD
+#else
+#define FCPP_MIOSIX_REFRESH_PERIOD 8
+#endif
+#endif
+
+//! @brief Whether the radio is operated by a dedicated thread by default.
+#ifndef FCPP_MIOSIX_RADIO_THREAD
+#define FCPP_MIOSIX_RADIO_THREAD true
+#endif
+
+//! @brief Stack size of the radio thread.
+#ifndef FCPP_MIOSIX_RADIO_STACK
+#define FCPP_MIOSIX_RADIO_STACK 2048
+#endif
+
+//! @brief Number of received frames queued by the radio thread (a power of two).
+#ifndef FCPP_MIOSIX_RECEIVE_QUEUE
+#define FCPP_MIOSIX_RECEIVE_QUEUE 16
+#endif
+
+//! @brief Number of messages queued for the radio thread to send (a power of two).
+#ifndef FCPP_MIOSIX_SEND_QUEUE
+#define FCPP_MIOSIX_SEND_QUEUE 2
+#endif
 
 
 /**
@@ -41,9 +163,24 @@ namespace os {
 
 void activity();
 
+/**
+ * @brief The log of the driver messages.
+ *
+ * Messages are written without locking from the radio thread too, and printed on the console
+ * by the FCPP thread on every receive (the oldest are overwritten if not printed in time).
+ */
+inline LogStreambuf& driver_log() {
+    static LogStreambuf l(FCPP_MIOSIX_LOG_SIZE, LogStreambuf::Mode::Ring);
+    return l;
+}
+
 //! @brief Access the local unique identifier.
 inline device_t uid() {
+#ifdef FCPP_MIOSIX_HOST
+    uint64_t id = miosix::getUniqueId();
+#else
     uint64_t id = *reinterpret_cast<uint64_t*>(0x0FE081F0);
+#endif
 #if   FCPP_DEVICE == 64
     return id;
 #else
@@ -66,6 +203,45 @@ inline device_t uid() {
  * bool send(device_t, std::vector<char>, int); // broadcasts a message after given attemps
  * message_type receive(int);                   // listens for messages after given failed sends
  * ~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * Sent messages are copied once into a preallocated frame, with the PAN header already
+ * in place, and retried from there. The FCPP hardware connector still serialises every
+ * round into a vector, so the connector, not the driver, owns that allocation.
+ * Symmetrically, `receive_frame(int)` returns a received frame in place in a slot of a
+ * fixed pool, which is recycled as soon as the returned handle is destroyed. The pool only
+ * spares the driver-side buffers: `receive(int)` still copies each message into the vector
+ * of the `message_type` handed to the connector, which allocates it.
+ *
+ * Messages larger than a frame are split into up to `FCPP_MIOSIX_MAX_FRAGMENTS` frames,
+ * and reassembled by `receive(int)` (see `fragment_counters()` for statistics).
+ * Messages up to `FCPP_MIOSIX_DELTA_SIZE` bytes are sent as differences from a keyframe
+ * broadcast every `keyframe_period` messages (see `delta_counters()` for statistics).
+ *
+ * Frames are timestamped in hardware at reception and, if `FCPP_MIOSIX_TIMESTAMPS` is true,
+ * carry the global transmit time of the sender, the root it follows and the latest sequence
+ * number of the root it heard, which feed `global_clock()`.
+ * If `tdma_slots` is positive, the radio follows a slotted schedule aligned to `global_clock()`:
+ * messages are sent only in the own slot of the device, and the radio is turned off in
+ * slots where no neighbour is expected.
+ *
+ * If `radio_thread` is true, a high-priority thread keeps receiving frames into a queue,
+ * from which `receive(int)` drains them, and sends the messages queued by `send`. The calling
+ * thread sleeps in `receive(int)` until woken up by the radio thread pushing a frame. In this
+ * mode, `send` returns false only if the send queue is full, and `receive_frame(int)` is
+ * reserved to the radio thread.
+ *
+ * If `heartbeat_period` is positive, messages up to `FCPP_MIOSIX_DELTA_SIZE` bytes equal to the
+ * previous one are not sent, except for a short heartbeat every `heartbeat_period` messages
+ * and the whole message every `refresh_period` messages. Receivers cache the last message of
+ * every neighbour, and deliver it again on heartbeats (see `quiescence_counters()` for statistics).
+ * Heartbeats should be frequent enough for neighbour messages not to expire in between.
+ *
+ * Sends and receptions are recorded in `radio_trace()`, instead of being printed, and
+ * errors are written into `driver_log()`.
+ * Frames carry a sequence number in the PAN header, from which `link_table()` estimates
+ * the quality of the link from each neighbour. The power of received messages is the
+ * distance of the sender in meters, estimated from the smoothed RSSI by `rssi_calibration()`,
+ * which also sets the RSSI threshold below which frames are discarded.
  */
 struct transceiver {
     //! @brief Default-constructible type for settings.
@@ -78,21 +254,128 @@ struct transceiver {
         long long receive_time;
         //! @brief Number of attempts after which a send is aborted.
         uint8_t send_attempts;
+        //! @brief Time in nanoseconds after which an incomplete fragmented message is dropped.
+        long long reassembly_time;
+        //! @brief Number of messages between keyframes in delta encoding (zero to disable it).
+        uint8_t keyframe_period;
+        //! @brief Number of TDMA slots in a period (zero for contention-based access).
+        uint8_t tdma_slots;
+        //! @brief TDMA period in nanoseconds.
+        long long tdma_period;
+        //! @brief Whether the radio is operated by a dedicated thread.
+        bool radio_thread;
+        //! @brief Number of unchanged messages between heartbeats (zero to always send messages).
+        uint8_t heartbeat_period;
+        //! @brief Number of unchanged messages after which a message is sent again anyway (zero for never).
+        uint8_t refresh_period;
 
         //! @brief Member constructor with defaults.
-        data_type(int freq = 2450, int pow = 5, long long recv = 50000000LL, uint8_t sndatt = 5) : frequency(freq), power(pow), receive_time(recv), send_attempts(sndatt) {}
+        data_type(int freq = 2450, int pow = 5, long long recv = 50000000LL, uint8_t sndatt = 5, long long reasm = 1000000000LL, uint8_t keyper = FCPP_MIOSIX_KEYFRAME_PERIOD, uint8_t slots = FCPP_MIOSIX_TDMA_SLOTS, long long tdmaper = FCPP_MIOSIX_TDMA_PERIOD, bool thread = FCPP_MIOSIX_RADIO_THREAD, uint8_t heartper = FCPP_MIOSIX_HEARTBEAT_PERIOD, uint8_t refper = FCPP_MIOSIX_REFRESH_PERIOD) : frequency(freq), power(pow), receive_time(recv), send_attempts(sndatt), reassembly_time(reasm), keyframe_period(keyper), tdma_slots(slots), tdma_period(tdmaper), radio_thread(thread), heartbeat_period(heartper), refresh_period(refper) {}
+    };
+
+    //! @brief Kinds of frames, as stated in the lower half of the byte following the PAN header.
+    enum class frame_kind : uint8_t {
+        whole,      //!< a whole message
+        fragment,   //!< a fragment of a message
+        heartbeat   //!< the sequence number of the frame carrying the last message, which is unchanged
     };
 
-    static const short rssiThreshold = -75; //dBm
     static const unsigned int maxPacketSize = 125;
     static const unsigned int panHeaderSize = 7;
+    static const unsigned int panSeqOffset = 2;
     static const char panHeader[panHeaderSize];
+    static const unsigned int headerSize = panHeaderSize + 1;
+    static const unsigned int syncSize = FCPP_MIOSIX_TIMESTAMPS ? sizeof(int64_t) + sizeof(device_t) + sizeof(uint16_t) : 0;
+    static const unsigned int trailerSize = syncSize + sizeof(device_t);
+    static const unsigned int maxPayloadSize = maxPacketSize - headerSize - trailerSize;
+    static const unsigned int fragmentSize = maxPayloadSize - fragment_header_size;
+    static const unsigned int maxMessageSize = fragmentSize * FCPP_MIOSIX_MAX_FRAGMENTS;
+    static const unsigned int maxQueuedSize = std::max<unsigned int>(maxMessageSize, FCPP_MIOSIX_DELTA_SIZE);
+
+    //! @brief A received frame, together with its reception data.
+    struct frame {
+        //! @brief Reception time (local clock, from the hardware timestamp).
+        times_t time;
+        //! @brief The sender.
+        device_t device;
+        //! @brief Estimated distance of the sender in meters (from the received power).
+        real_t power;
+        //! @brief Received power in dBm.
+        int8_t rssi;
+        //! @brief Size of the whole frame.
+        unsigned int size;
+        //! @brief The whole frame, headers included.
+        char data[maxPacketSize];
+
+        //! @brief The kind of the frame.
+        frame_kind kind() const {
+            return frame_kind(data[panHeaderSize] & 15);
+        }
+
+        //! @brief The encoding of the message (or fragment) carried by the frame.
+        message_encoding encoding() const {
+            return message_encoding(uint8_t(data[panHeaderSize]) >> 4);
+        }
+
+        //! @brief The message (or fragment) carried by the frame.
+        char const* content() const {
+            return data + headerSize;
+        }
+
+        //! @brief The size of the message (or fragment) carried by the frame.
+        size_t content_size() const {
+            return size - headerSize - trailerSize;
+        }
+    };
+
+    //! @brief Pool of frames that can be received.
+    using frame_pool = pool<frame, FCPP_MIOSIX_RECEIVE_SLOTS>;
+
+    //! @brief Handle to a received frame (recycled on destruction).
+    using frame_pointer = frame_pool::pointer;
+
+    //! @brief Reassembler of fragmented messages.
+    using reassembler_type = reassembler<fragmentSize, FCPP_MIOSIX_MAX_FRAGMENTS, FCPP_MIOSIX_REASSEMBLY_SLOTS>;
+
+    //! @brief Delta encoder of outgoing messages.
+    using encoder_type = delta_encoder<FCPP_MIOSIX_DELTA_SIZE>;
+
+    //! @brief Delta decoder of incoming messages.
+    using decoder_type = delta_decoder<FCPP_MIOSIX_DELTA_SIZE, FCPP_MIOSIX_DELTA_SLOTS>;
+
+    //! @brief Filter of unchanged outgoing messages.
+    using filter_type = quiet_filter<FCPP_MIOSIX_DELTA_SIZE>;
+
+    //! @brief Cache of the last messages from neighbours.
+    using cache_type = message_cache<FCPP_MIOSIX_DELTA_SIZE, FCPP_MIOSIX_DELTA_SLOTS>;
+
+    //! @brief A message queued for the radio thread to send.
+    struct outgoing {
+        //! @brief The sender.
+        device_t device;
+        //! @brief Size of the message.
+        size_t size;
+        //! @brief The message.
+        char data[maxQueuedSize];
+    };
+
+    //! @brief Queue of received frames, from the radio thread.
+    using inbox_type = spsc_queue<frame_pointer, FCPP_MIOSIX_RECEIVE_QUEUE>;
+
+    //! @brief Queue of messages to be sent, to the radio thread.
+    using outbox_type = spsc_queue<outgoing, FCPP_MIOSIX_SEND_QUEUE>;
 
     //! @brief Network settings.
     data_type data;
 
     //! @brief Constructor with settings.
-    transceiver(data_type d) : data(d), m_transceiver(miosix::Transceiver::instance()), m_timer(miosix::getTransceiverTimer()), m_fcpp_timer(common::make_tagged_tuple<>()), m_rng(std::chrono::system_clock::now().time_since_epoch().count()) {
+    transceiver(data_type d) : data(d), m_transceiver(miosix::Transceiver::instance()), m_timer(miosix::getTransceiverTimer()), m_fcpp_timer(common::make_tagged_tuple<>()), m_rng(std::chrono::system_clock::now().time_since_epoch().count()), m_pool(new frame_pool()), m_reassembler(new reassembler_type(d.reassembly_time * 1e-9)), m_encoder(new encoder_type(d.keyframe_period)), m_decoder(new decoder_type()), m_filter(new filter_type(d.heartbeat_period, d.refresh_period)), m_cache(new cache_type()) {
+        global_clock().uid(uid());
+        rssi_calibration().configure(uid(), data.power);
+        if (data.tdma_slots > 0)
+            m_tdma.reset(new tdma_schedule(uid(), data.tdma_period * 1e-9, data.tdma_slots, FCPP_MIOSIX_TDMA_DISCOVERY));
+        m_tick0 = m_timer.getValue();
+        m_time0 = m_fcpp_timer.real_time();
         miosix::TransceiverConfiguration config(
             data.frequency,
             data.power,
@@ -101,80 +384,329 @@ struct transceiver {
         );
         m_transceiver.configure(config);
         m_transceiver.turnOn();
+        memcpy(m_frame, panHeader, panHeaderSize);
+        if (data.radio_thread) {
+            m_inbox.reset(new inbox_type());
+            m_outbox.reset(new outbox_type());
+            m_running = true;
+            m_radio = miosix::Thread::create(&transceiver::radio_main, FCPP_MIOSIX_RADIO_STACK, miosix::PRIORITY_MAX-1, this, miosix::Thread::JOINABLE);
+            if (m_radio == nullptr) {
+                report("Radio thread creation failed: operating the radio inline\n");
+                m_running = false;
+                data.radio_thread = false;
+            }
+        }
     }
 
-    //! @brief Broadcasts a given message.
-    bool send(device_t id, const std::vector<char>& m, int attempt) const {
-        char packet[maxPacketSize];
-        unsigned int size = panHeaderSize + m.size() + sizeof(device_t);
-
-        if (size > maxPacketSize) {
-            printf("Send failed: message overflow (%d/125 bytes)\n", m.size());
-            return true;
-        }
+    //! @brief Destructor, stopping the radio thread.
+    ~transceiver() {
+        if (m_radio == nullptr) return;
+        m_running = false;
+        m_radio->join();
+    }
 
-        //TODO: in case of channel not clear we red this operation multiple times
-        char *ptr = packet;
-        memcpy(ptr, panHeader, panHeaderSize);
-        ptr += panHeaderSize;
-        memcpy(ptr, m.data(), m.size());
-        ptr += m.size();
-        memcpy(ptr, &id, sizeof(device_t));
-        
-        try {
-            if (m_transceiver.sendCca(packet, size)) {
-                activity();
-                #ifdef DBG_PRINT_SUCCESSFUL_CALLS
-                printf("Sent %d byte packet\n", size);
-                #endif //DBG_PRINT_SUCCESSFUL_CALLS
-                return true;
-            } else return attempt == data.send_attempts;
-        } catch (std::exception& e) {
-            printf("Send failed: %s\n", e.what());
-            return attempt == data.send_attempts;
-        }
+    //! @brief Broadcasts a given message (encoded and copied into the frame buffer only once).
+    bool send(device_t id, const std::vector<char>& m, int attempt) const {
+        if (data.radio_thread) return enqueue(id, m.data(), m.size());
+        return send_message(id, m.data(), m.size(), attempt);
     }
 
-    //! @brief Receives the next incoming message (empty if no incoming message).
-    message_type receive(int attempt) const {
-        long long interval = (data.receive_time << attempt);
-        if (attempt > 0) {
-            std::uniform_int_distribution<long long> d(data.receive_time, interval);
-            interval = d(m_rng);
+    //! @brief Receives the next incoming frame in place in the pool (empty if no incoming message).
+    frame_pointer receive_frame(int attempt) const {
+        long long deadline;
+        if (m_tdma) {
+            times_t until;
+            bool listen = m_tdma->listening(global_clock().global(local_time(m_timer.getValue())), until);
+            deadline = ticks(global_clock().local(until));
+            if (not listen) {
+                m_transceiver.turnOff();
+                m_timer.absoluteWait(deadline);
+                m_transceiver.turnOn();
+                return frame_pointer();
+            }
+        } else {
+            long long interval = (data.receive_time << attempt);
+            if (attempt > 0) {
+                std::uniform_int_distribution<long long> d(data.receive_time, interval);
+                interval = d(m_rng);
+            }
+            deadline = m_timer.getValue() + m_timer.ns2tick(interval);
+        }
+        frame_pointer f = m_pool->acquire();
+        if (not f) {
+            trace(trace_event::pool_full, 0);
+            return f;
         }
-        interval = m_timer.ns2tick(interval);
-        message_type m;
         try {
-            char packet[maxPacketSize];
-            auto result = m_transceiver.recv(packet, maxPacketSize, m_timer.getValue() + interval);
+            auto result = m_transceiver.recv(f->data, maxPacketSize, deadline);
             if (result.error == miosix::RecvResult::OK
-            and result.size >= static_cast<int>(panHeaderSize + sizeof(device_t))
-            and memcmp(packet, panHeader, panHeaderSize) == 0
-            and result.rssi >= rssiThreshold) {
-                m.time = m_fcpp_timer.real_time();
-                m.power = result.rssi; // TODO: convert in meters
-                m.device = *reinterpret_cast<device_t*>(packet + result.size - sizeof(device_t));
-                m.content.resize(result.size - panHeaderSize - sizeof(device_t));
-                memcpy(m.content.data(), packet + panHeaderSize, result.size - panHeaderSize - sizeof(device_t));
+            and result.size >= static_cast<int>(headerSize + trailerSize)
+            and memcmp(f->data, panHeader, panSeqOffset) == 0
+            and memcmp(f->data + panSeqOffset + 1, panHeader + panSeqOffset + 1, panHeaderSize - panSeqOffset - 1) == 0
+            and result.rssi >= rssi_calibration().threshold) {
+                f->time = local_time(result.timestampValid ? result.timestamp : m_timer.getValue());
+                f->size = result.size;
+                f->rssi = int8_t(result.rssi);
+                memcpy(&f->device, f->data + result.size - sizeof(device_t), sizeof(device_t));
+                link_table().update(f->device, f->data[panSeqOffset], result.rssi, f->time);
+                f->power = link_table()(f->device, f->time).distance;
+                if (FCPP_MIOSIX_TIMESTAMPS) {
+                    int64_t ns;
+                    device_t root;
+                    uint16_t seq;
+                    char const* p = f->data + result.size - trailerSize;
+                    memcpy(&ns, p, sizeof(int64_t));
+                    memcpy(&root, p + sizeof(int64_t), sizeof(device_t));
+                    memcpy(&seq, p + sizeof(int64_t) + sizeof(device_t), sizeof(uint16_t));
+                    global_clock().sample(f->time, ns * 1e-9, root, seq);
+                }
+                if (m_tdma) m_tdma->heard(f->device, global_clock().global(f->time));
                 activity();
-                #ifdef DBG_PRINT_SUCCESSFUL_CALLS
-                printf("Received %d byte packet from device %d at time %f\n", result.size, m.device, m.time);
-                #endif //DBG_PRINT_SUCCESSFUL_CALLS
+                trace(trace_event::received, result.size, result.rssi, f->device);
+                return f;
             } else {
                 switch (result.error) {
-                    case miosix::RecvResult::OK: printf("Receive error: packet is short/has wrong header/low RSSI\n"); break;
-                    case miosix::RecvResult::TOO_LONG: printf("Receive error: too long packet (%d/125 bytes)\n", result.size); break;
-                    case miosix::RecvResult::CRC_FAIL: printf("Receive error: wrong CRC\n"); break;
+                    case miosix::RecvResult::OK: trace(trace_event::rejected, result.size, result.rssi); break;
+                    case miosix::RecvResult::TOO_LONG: trace(trace_event::too_long, result.size, result.rssi); break;
+                    case miosix::RecvResult::CRC_FAIL: trace(trace_event::crc_fail, result.size, result.rssi); break;
                     case miosix::RecvResult::TIMEOUT:  break;
                 }
             }
         } catch(std::exception& e) {
-            printf("Receive exception: %s\n", e.what());
+            trace(trace_event::receive_error, 0);
+            report("Receive exception: %s\n", e.what());
+        }
+        return frame_pointer();
+    }
+
+    //! @brief Receives the next incoming frame, from the radio thread if any (empty if no incoming message).
+    frame_pointer next_frame(int attempt) const {
+        if (not data.radio_thread) return receive_frame(attempt);
+        frame_pointer f;
+        long long deadline = miosix::getTime() + data.receive_time;
+        m_consumer.store(miosix::Thread::getCurrentThread(), std::memory_order_release);
+        while (not m_inbox->pop(f)) {
+            // interrupts are disabled between the check and the wait, so that no wakeup is missed
+            miosix::FastInterruptDisableLock lock;
+            if (m_inbox->empty() and miosix::Thread::IRQenableIrqAndTimedWait(lock, deadline) == miosix::TimedWaitResult::Timeout) {
+                m_inbox->pop(f);
+                break;
+            }
+        }
+        return f;
+    }
+
+    //! @brief Receives the next incoming message (empty if no incoming message or incomplete fragments).
+    message_type receive(int attempt) const {
+        driver_log().flushMirror();
+        message_type m;
+        frame_pointer f = next_frame(attempt);
+        if (not f) return m;
+        char const* content;
+        size_t size;
+        switch (f->kind()) {
+            case frame_kind::whole:
+                content = f->content();
+                size = f->content_size();
+                break;
+            case frame_kind::fragment:
+                if (not m_reassembler->insert(f->device, f->content(), f->content_size(), f->time, content, size)) return m;
+                break;
+            case frame_kind::heartbeat:
+                if (f->content_size() < 1 or not m_cache->replay(f->device, uint8_t(f->content()[0]), content, size)) return m;
+                break;
+            default:
+                trace(trace_event::unknown_kind, f->size, f->rssi, f->device);
+                return m;
         }
+        if (f->kind() != frame_kind::heartbeat) {
+            if (not m_decoder->decode(f->device, f->encoding(), content, size, content, size)) return m;
+            m_cache->store(f->device, uint8_t(f->data[panSeqOffset]), content, size);
+        }
+        // the connector takes messages as vectors: this is the only allocation per message
+        m.content.assign(content, content + size);
+        m.time = f->time;
+        m.power = f->power;
+        m.device = f->device;
         return m;
     }
 
   private:
+    //! @brief Entry point of the radio thread.
+    static void radio_main(void* arg) {
+        static_cast<transceiver*>(arg)->radio_loop();
+    }
+
+    //! @brief Alternates sending the queued messages and receiving frames into the queue, until stopped.
+    void radio_loop() const {
+        int attempt = 0;
+        while (m_running) {
+            if (outgoing* o = m_outbox->front()) {
+                if (send_message(o->device, o->data, o->size, attempt)) {
+                    m_outbox->pop();
+                    attempt = 0;
+                } else ++attempt;
+            }
+            frame_pointer f = receive_frame(attempt);
+            if (not f) continue;
+            if (not m_inbox->push(std::move(f)))
+                trace(trace_event::queue_full, f->size, f->rssi, f->device);
+            else if (miosix::Thread* t = m_consumer.load(std::memory_order_acquire))
+                t->wakeup();
+        }
+    }
+
+    //! @brief Queues a copy of a message for the radio thread.
+    bool enqueue(device_t id, char const* m, size_t len) const {
+        if (len > maxQueuedSize) {
+            report("Send failed: message overflow (%d/%d bytes)\n", int(len), maxQueuedSize);
+            return true;
+        }
+        outgoing* o = m_outbox->back();
+        if (o == nullptr) return false;
+        o->device = id;
+        o->size = len;
+        memcpy(o->data, m, len);
+        m_outbox->push();
+        return true;
+    }
+
+    //! @brief Broadcasts a message (encoded and copied into the frame buffer only once), unless unchanged.
+    bool send_message(device_t id, char const* m, size_t len, int attempt) const {
+        if (attempt == 0) {
+            m_action = m_filter->check(m, len);
+            if (m_action == quiet_action::send)
+                m_encoding = m_encoder->encode(m, len, m_encoded, m_encoded_size);
+            m_staged = false;
+        }
+        if (m_action == quiet_action::skip) return true;
+        if (m_action == quiet_action::send and m_encoded_size > maxMessageSize) {
+            report("Send failed: message overflow (%d/%d bytes)\n", int(m_encoded_size), maxMessageSize);
+            return true;
+        }
+        if (deferred()) return false;
+        if (m_action == quiet_action::heartbeat) return send_heartbeat(id, attempt);
+        bool done;
+        if (m_encoded_size > maxPayloadSize) done = send_fragments(id, attempt);
+        else {
+            if (not m_staged) memcpy(m_frame + headerSize, m_encoded, m_encoded_size);
+            m_staged = true;
+            done = send_whole(id, m_encoded_size, m_encoding, attempt);
+        }
+        if (done and m_transmitted) m_message_seq = m_frame[panSeqOffset] - 1;
+        else if (done) m_filter->reset();
+        return done;
+    }
+
+    //! @brief Converts a local time into transceiver timer ticks.
+    long long ticks(times_t t) const {
+        return m_tick0 + m_timer.ns2tick((long long)(double(t - m_time0) * 1e9));
+    }
+
+    //! @brief Converts transceiver timer ticks into a local time.
+    times_t local_time(long long ticks) const {
+        return m_time0 + m_timer.tick2ns(ticks - m_tick0) * 1e-9;
+    }
+
+    //! @brief Whether sending has to wait for the own TDMA slot.
+    bool deferred() const {
+        return m_tdma and not m_tdma->transmitting(global_clock().global(local_time(m_timer.getValue())));
+    }
+
+    //! @brief Whether a failed send should be aborted (never with TDMA, where attempts include waits for the slot).
+    bool give_up(int attempt) const {
+        return not m_tdma and attempt == data.send_attempts;
+    }
+
+    //! @brief Broadcasts the first bytes of the outgoing frame (stamping the global time), returning whether it succeeded.
+    bool transmit(unsigned int size) const {
+        if (FCPP_MIOSIX_TIMESTAMPS) {
+            int64_t ns = int64_t(double(global_clock().global(local_time(m_timer.getValue()))) * 1e9);
+            device_t root;
+            uint16_t seq;
+            global_clock().stamp(root, seq);
+            char* p = m_frame + size - trailerSize;
+            memcpy(p, &ns, sizeof(int64_t));
+            memcpy(p + sizeof(int64_t), &root, sizeof(device_t));
+            memcpy(p + sizeof(int64_t) + sizeof(device_t), &seq, sizeof(uint16_t));
+        }
+        try {
+            if (m_transceiver.sendCca(m_frame, size)) {
+                ++m_frame[panSeqOffset];
+                activity();
+                trace(trace_event::sent, size);
+                return m_transmitted = true;
+            }
+            trace(trace_event::channel_busy, size);
+        } catch (std::exception& e) {
+            trace(trace_event::send_error, size);
+            report("Send failed: %s\n", e.what());
+        }
+        return m_transmitted = false;
+    }
+
+    //! @brief Writes a message into the driver log (from any thread).
+    __attribute__((format(printf, 1, 2)))
+    static void report(char const* format, ...) {
+        char buf[128];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        if (n > 0) driver_log().write(buf, n < int(sizeof(buf)) ? n : sizeof(buf) - 1);
+    }
+
+    //! @brief Records an event in the radio trace, at the current time.
+    void trace(trace_event e, size_t size, int rssi = 0, device_t peer = 0) const {
+        radio_trace().record(m_timer.tick2ns(m_timer.getValue()), e, size, rssi, peer);
+    }
+
+    //! @brief Writes the byte following the PAN header.
+    void set_kind(frame_kind k, message_encoding e) const {
+        m_frame[panHeaderSize] = char(uint8_t(k) | (uint8_t(e) << 4));
+    }
+
+    //! @brief Broadcasts the first bytes of the outgoing frame payload as a message with a given encoding.
+    bool send_whole(device_t id, size_t len, message_encoding e, int attempt) const {
+        if (len > maxPayloadSize) {
+            report("Send failed: message overflow (%d/%d bytes)\n", int(len), maxPayloadSize);
+            return true;
+        }
+        set_kind(frame_kind::whole, e);
+        memcpy(m_frame + headerSize + len + syncSize, &id, sizeof(device_t));
+        return transmit(headerSize + len + trailerSize) or give_up(attempt);
+    }
+
+    //! @brief Broadcasts a heartbeat, referring to the frame carrying the last message sent.
+    bool send_heartbeat(device_t id, int attempt) const {
+        set_kind(frame_kind::heartbeat, message_encoding::raw);
+        m_frame[headerSize] = char(m_message_seq);
+        memcpy(m_frame + headerSize + 1 + syncSize, &id, sizeof(device_t));
+        return transmit(headerSize + 1 + trailerSize) or give_up(attempt);
+    }
+
+    //! @brief Broadcasts the fragments of the encoded message not yet sent in previous attempts.
+    bool send_fragments(device_t id, int attempt) const {
+        size_t count = (m_encoded_size + fragmentSize - 1) / fragmentSize;
+        if (attempt == 0) {
+            ++m_fragment_seq;
+            m_fragment_next = 0;
+        }
+        set_kind(frame_kind::fragment, m_encoding);
+        for (; m_fragment_next < count; ++m_fragment_next) {
+            size_t offs = m_fragment_next * fragmentSize;
+            size_t len = std::min<size_t>(fragmentSize, m_encoded_size - offs);
+            char* p = m_frame + headerSize;
+            write_fragment_header(p, m_fragment_seq, m_fragment_next, count);
+            memcpy(p + fragment_header_size, m_encoded + offs, len);
+            memcpy(p + fragment_header_size + len + syncSize, &id, sizeof(device_t));
+            if (not transmit(headerSize + fragment_header_size + len + trailerSize))
+                return give_up(attempt);
+            fragment_counters().sent.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
     //! @brief The miosix transceiver interface.
     miosix::Transceiver& m_transceiver;
     //! @brief The miosix transceiver timer.
@@ -183,6 +715,54 @@ struct transceiver {
     component::combine<>::component<>::net m_fcpp_timer;
     //! @brief A random engine.
     mutable std::default_random_engine m_rng;
+    //! @brief The outgoing frame, with the PAN header already in place (and the next sequence number).
+    mutable char m_frame[maxPacketSize];
+    //! @brief The frames available for reception (allocated once at construction).
+    std::unique_ptr<frame_pool> m_pool;
+    //! @brief The fragmented messages under reassembly (allocated once at construction).
+    std::unique_ptr<reassembler_type> m_reassembler;
+    //! @brief Sequence number of the last fragmented message sent.
+    mutable uint8_t m_fragment_seq = 0;
+    //! @brief Index of the next fragment to be sent.
+    mutable size_t m_fragment_next = 0;
+    //! @brief The delta encoder of outgoing messages (allocated once at construction).
+    std::unique_ptr<encoder_type> m_encoder;
+    //! @brief The delta decoder of incoming messages (allocated once at construction).
+    std::unique_ptr<decoder_type> m_decoder;
+    //! @brief The filter of unchanged outgoing messages (allocated once at construction).
+    std::unique_ptr<filter_type> m_filter;
+    //! @brief The cache of the last messages from neighbours (allocated once at construction).
+    std::unique_ptr<cache_type> m_cache;
+    //! @brief What to do with the message being sent.
+    mutable quiet_action m_action = quiet_action::send;
+    //! @brief Sequence number of the frame carrying the last message sent.
+    mutable uint8_t m_message_seq = 0;
+    //! @brief Whether the last frame has been transmitted.
+    mutable bool m_transmitted = false;
+    //! @brief The encoding of the message being sent.
+    mutable message_encoding m_encoding = message_encoding::raw;
+    //! @brief The message being sent, after encoding.
+    mutable char const* m_encoded = nullptr;
+    //! @brief The size of the message being sent, after encoding.
+    mutable size_t m_encoded_size = 0;
+    //! @brief Whether the message being sent is already in the outgoing frame.
+    mutable bool m_staged = false;
+    //! @brief The TDMA schedule (null for contention-based access).
+    std::unique_ptr<tdma_schedule> m_tdma;
+    //! @brief Transceiver timer value at construction.
+    long long m_tick0;
+    //! @brief Local time at construction.
+    times_t m_time0;
+    //! @brief The frames received by the radio thread (null without radio thread).
+    std::unique_ptr<inbox_type> m_inbox;
+    //! @brief The messages to be sent by the radio thread (null without radio thread).
+    std::unique_ptr<outbox_type> m_outbox;
+    //! @brief Whether the radio thread should keep running.
+    std::atomic<bool> m_running{false};
+    //! @brief The thread receiving messages, to be woken up by the radio thread (null until it first receives).
+    mutable std::atomic<miosix::Thread*> m_consumer{nullptr};
+    //! @brief The radio thread (null without radio thread).
+    miosix::Thread* m_radio = nullptr;
 };
 
 
@@ -0,0 +1,174 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lib/settings.hpp"
+#include "lib/common/tagged_tuple.hpp"
+
+#include "row_dump.hpp"
+#include "row_log.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+    //! @brief Tags of the columns of the checked rows.
+    namespace tags {
+        //! @brief Time of a row.
+        struct row_time {};
+        //! @brief A small integer.
+        struct row_count {};
+        //! @brief A real number.
+        struct row_value {};
+    }
+
+    //! @brief The row store of a block.
+    using block_type = plot::compressed_rows<tags::row_time, component::tags::tuple_store<tags::row_count, int, tags::row_value, real_t>, 4096>;
+
+    //! @brief A store of several blocks of rows, as persisted by `flash_rows`.
+    struct block_store {
+        //! @brief The blocks.
+        std::vector<block_type> blocks;
+
+        //! @brief Calls `f(data, size)` on every block of encoded rows.
+        template <typename F>
+        void for_each_block(F&& f) const {
+            for (auto const& b : blocks) f(b.data().data(), b.byte_size());
+        }
+
+        //! @brief Number of rows dropped.
+        size_t dropped() const {
+            return 3;
+        }
+    };
+
+    //! @brief Fills a store with blocks of rows of different lengths.
+    inline block_store make_store() {
+        block_store store;
+        for (int b = 0; b < 3; ++b) {
+            store.blocks.emplace_back();
+            for (int i = 0; i < 40 + 30 * b; ++i)
+                store.blocks.back() << common::make_tagged_tuple<tags::row_time, tags::row_count, tags::row_value>(times_t(b * 100 + i * 0.25), i / 3 - b, real_t(i % 5) / 4);
+        }
+        return store;
+    }
+
+    //! @brief The lines of a dump of a store, preceded and followed by other console output.
+    inline std::vector<std::string> dump_lines(block_store const& store) {
+        std::stringstream ss;
+        ss << "boot" << std::endl;
+        os::dump_rows(ss, store);
+        ss << "dump done" << std::endl;
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(ss, line)) lines.push_back(line);
+        return lines;
+    }
+
+    //! @brief Reads console lines, returning the lines not belonging to a dump.
+    inline std::vector<std::string> read_lines(os::dump_reader& reader, std::vector<std::string> const& lines) {
+        std::vector<std::string> other;
+        for (auto const& l : lines) if (not reader.read(l)) other.push_back(l);
+        return other;
+    }
+
+    //! @brief The rows decoded from a block.
+    inline std::string decoded(std::vector<char> const& block) {
+        std::stringstream ss;
+        block_type::decode(ss, block.data(), block.size());
+        return ss.str();
+    }
+
+    //! @brief The index of the `k`-th frame line in a dump.
+    inline size_t frame_line(std::vector<std::string> const& lines, size_t k) {
+        size_t i = 0;
+        while (lines[i].compare(0, 3, "#R ") != 0) ++i;
+        return i + k;
+    }
+}
+
+
+/**
+ * @brief Checks that rows dumped as console lines are decoded back by `dump_reader` (as in `rowdump`).
+ *
+ * Dumps are checked as printed, and after corrupting, losing or truncating some of their
+ * lines: the blocks which are not affected have to be recovered exactly, and the affected
+ * ones up to the damage. Returns non-zero on failure.
+ */
+int main() {
+    using namespace fcpp;
+
+    int failures = 0;
+    auto check = [&](bool ok, char const* what) {
+        if (not ok) {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    };
+    block_store store = make_store();
+    std::vector<std::vector<char>> blocks;
+    for (auto const& b : store.blocks) blocks.push_back(b.data());
+    std::vector<std::string> lines = dump_lines(store);
+    std::cout << lines.size() - 4 << " frames dumped for " << blocks[0].size() + blocks[1].size() + blocks[2].size() << " bytes" << std::endl;
+    {
+        os::dump_reader reader;
+        std::vector<std::string> other = read_lines(reader, lines);
+        check(other == std::vector<std::string>{"boot", "dump done"}, "other lines left unchanged");
+        check(reader.ended() == false and reader.dumping() == false, "dump ended");
+        check(reader.blocks() == blocks and reader.lost() == 0 and reader.dropped() == 3, "blocks read back");
+    }
+    {
+        // the second frame of the first block is corrupted
+        std::vector<std::string> damaged = lines;
+        damaged[frame_line(lines, 1)][5] ^= 1;
+        os::dump_reader reader;
+        read_lines(reader, damaged);
+        std::string full = decoded(blocks[0]), part = reader.blocks().empty() ? "" : decoded(reader.blocks()[0]);
+        check(reader.blocks().size() == 3 and reader.blocks()[0].size() == os::dump_payload_size, "corrupted block truncated");
+        check(part.size() < full.size() and full.compare(0, part.size(), part) == 0, "rows decoded before the corrupted frame");
+        check(std::vector<std::vector<char>>(reader.blocks().begin() + 1, reader.blocks().end()) == std::vector<std::vector<char>>(blocks.begin() + 1, blocks.end()), "blocks after a corrupted frame read back");
+        check(reader.lost() == 1, "corrupted frame counted as lost");
+    }
+    {
+        // the first frame of the second block is lost
+        std::vector<std::string> damaged = lines;
+        size_t i = frame_line(lines, (blocks[0].size() + os::dump_payload_size - 1) / os::dump_payload_size);
+        damaged.erase(damaged.begin() + i);
+        os::dump_reader reader;
+        read_lines(reader, damaged);
+        check(reader.blocks().size() == 2 and reader.blocks()[0] == blocks[0] and reader.blocks()[1] == blocks[2], "block with a lost first frame skipped");
+        check(reader.lost() == 1, "lost frame counted");
+    }
+    for (std::string end : {"#end ", "#end x", "#end 12x", "#end -3", "#end 99999999999999999999999"}) {
+        // the frame count is truncated or corrupted
+        std::vector<std::string> damaged = lines;
+        damaged[damaged.size() - 2] = end;
+        os::dump_reader reader;
+        bool ended = false;
+        for (auto const& l : damaged) ended = (reader.read(l) and reader.ended()) or ended;
+        check(ended and reader.blocks() == blocks and reader.lost() == 0, "corrupted frame count ignored");
+    }
+    {
+        // the capture ends in the middle of the last block
+        std::vector<std::string> damaged(lines.begin(), lines.end() - 3);
+        os::dump_reader reader;
+        read_lines(reader, damaged);
+        check(reader.dumping() and reader.blocks().size() == 3 and reader.blocks()[0] == blocks[0] and reader.blocks()[1] == blocks[1], "truncated dump read");
+    }
+    {
+        // two dumps in the same capture
+        std::vector<std::string> twice = lines;
+        twice.insert(twice.end(), lines.begin(), lines.end());
+        twice[frame_line(lines, 1)][5] ^= 1;
+        os::dump_reader reader;
+        read_lines(reader, twice);
+        check(reader.blocks() == blocks and reader.lost() == 0, "second dump read independently");
+    }
+    if (failures == 0) std::cout << "all checks passed" << std::endl;
+    return failures;
+}
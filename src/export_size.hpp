@@ -0,0 +1,191 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file export_size.hpp
+ * @brief Compile-time upper bounds on the serialised size of exports.
+ */
+
+#ifndef FCPP_MIOSIX_EXPORT_SIZE_H_
+#define FCPP_MIOSIX_EXPORT_SIZE_H_
+
+#include <cstddef>
+
+#include <array>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lib/settings.hpp"
+#include "lib/common/traits.hpp"
+#include "lib/common/tuple.hpp"
+
+#include "digest.hpp"
+#include "flat_map.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Bytes taken by the number of elements of a serialised container.
+constexpr size_t container_header_size = sizeof(size_t);
+
+/**
+ * @brief Maximum number of elements of a container type `T`, given the maximum number of neighbours.
+ *
+ * Containers of unbounded size (as `std::vector` or `std::unordered_map`) can appear in exports
+ * only if a bound is declared by specialising this template, e.g.
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~{.cpp}
+ * template <size_t hood>
+ * struct capacity_bound<std::vector<device_t>, hood> : std::integral_constant<size_t, hood> {};
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+template <typename T, size_t hood>
+struct capacity_bound : std::integral_constant<size_t, 0> {};
+
+
+//! @cond INTERNAL
+namespace details {
+    //! @brief Sum of sizes.
+    constexpr size_t size_sum() {
+        return 0;
+    }
+    template <typename... Ts>
+    constexpr size_t size_sum(size_t x, Ts... xs) {
+        return x + size_sum(xs...);
+    }
+
+    //! @brief Serialised size of types without a specific bound (only trivially copyable ones).
+    template <typename T>
+    struct default_size : std::integral_constant<size_t, sizeof(T)> {
+        static_assert(std::is_trivially_copyable<T>::value, "no serialised size bound for this type: specialise serialized_size or capacity_bound");
+    };
+}
+//! @endcond
+
+
+//! @brief Upper bound on the serialised size of a type `T`, given the maximum number of neighbours.
+template <typename T, size_t hood>
+struct serialized_size : details::default_size<T> {};
+
+//! @brief Upper bound on the serialised size of a type (ignoring cv-qualifiers).
+template <typename T, size_t hood>
+struct serialized_size<T const, hood> : serialized_size<T, hood> {};
+
+//! @brief Upper bound on the serialised size of a pair.
+template <typename T, typename U, size_t hood>
+struct serialized_size<std::pair<T, U>, hood> : std::integral_constant<size_t, serialized_size<T, hood>::value + serialized_size<U, hood>::value> {};
+
+//! @brief Upper bound on the serialised size of a standard tuple.
+template <typename... Ts, size_t hood>
+struct serialized_size<std::tuple<Ts...>, hood> : std::integral_constant<size_t, details::size_sum(serialized_size<Ts, hood>::value...)> {};
+
+//! @brief Upper bound on the serialised size of a tuple.
+template <typename... Ts, size_t hood>
+struct serialized_size<common::tuple<Ts...>, hood> : std::integral_constant<size_t, details::size_sum(serialized_size<Ts, hood>::value...)> {};
+
+//! @brief Upper bound on the serialised size of an array.
+template <typename T, size_t N, size_t hood>
+struct serialized_size<std::array<T, N>, hood> : std::integral_constant<size_t, N * serialized_size<T, hood>::value> {};
+
+//! @brief Upper bound on the serialised size of a vector (with a declared capacity bound).
+template <typename T, typename A, size_t hood>
+struct serialized_size<std::vector<T, A>, hood> : std::integral_constant<size_t, container_header_size + capacity_bound<std::vector<T, A>, hood>::value * serialized_size<T, hood>::value> {
+    static_assert(capacity_bound<std::vector<T, A>, hood>::value > 0, "no capacity bound declared for this vector type: specialise capacity_bound");
+};
+
+//! @brief Upper bound on the serialised size of a map (with a declared capacity bound).
+template <typename K, typename V, typename C, typename A, size_t hood>
+struct serialized_size<std::map<K, V, C, A>, hood> : std::integral_constant<size_t, container_header_size + capacity_bound<std::map<K, V, C, A>, hood>::value * serialized_size<std::pair<K, V>, hood>::value> {
+    static_assert(capacity_bound<std::map<K, V, C, A>, hood>::value > 0, "no capacity bound declared for this map type: specialise capacity_bound");
+};
+
+//! @brief Upper bound on the serialised size of an unordered map (with a declared capacity bound).
+template <typename K, typename V, typename H, typename E, typename A, size_t hood>
+struct serialized_size<std::unordered_map<K, V, H, E, A>, hood> : std::integral_constant<size_t, container_header_size + capacity_bound<std::unordered_map<K, V, H, E, A>, hood>::value * serialized_size<std::pair<K, V>, hood>::value> {
+    static_assert(capacity_bound<std::unordered_map<K, V, H, E, A>, hood>::value > 0, "no capacity bound declared for this map type: specialise capacity_bound");
+};
+
+//! @brief Upper bound on the serialised size of a flat map.
+template <typename K, typename V, size_t N, typename E, size_t hood>
+struct serialized_size<flat_map<K, V, N, E>, hood> : std::integral_constant<size_t, sizeof(typename flat_map<K, V, N, E>::size_type) + N * serialized_size<std::pair<K, V>, hood>::value> {};
+
+//! @brief Upper bound on the serialised size of an epoch digest.
+template <size_t E, size_t M, size_t K, size_t hood>
+struct serialized_size<epoch_bloom<E, M, K>, hood> : std::integral_constant<size_t, sizeof(uint16_t) + E * M / 8> {};
+
+
+/**
+ * @brief Export list `L` of an aggregate function calling `nbr` or `old` up to `n` times on the same type.
+ *
+ * Export lists only hold the distinct types of the values exported, while every call
+ * exporting a value stores a separate entry: `n` has to count the calls of the function
+ * on any single type, including the ones in the library functions it calls.
+ */
+template <typename L, size_t n>
+struct export_calls {};
+
+
+/**
+ * @brief Upper bound on the serialised size of the values of an export list `L`, given the maximum number of neighbours.
+ *
+ * Values are stored together with their trace in a container for each type, holding an
+ * entry for every call exporting a value of that type. A plain export list is assumed to
+ * export each type once, and is a bound only if so: functions exporting a type more than
+ * once must be given as `export_calls`. Values used only through `old` are counted as well,
+ * even though they may be kept in a separate export.
+ */
+template <typename L, size_t hood>
+struct export_size;
+
+//! @brief Upper bound on the serialised size of the values of an export list, exporting each type up to `n` times.
+template <typename... Ts, size_t n, size_t hood>
+struct export_size<export_calls<common::type_sequence<Ts...>, n>, hood> : std::integral_constant<size_t, details::size_sum((container_header_size + n * (sizeof(trace_t) + serialized_size<Ts, hood>::value))...)> {};
+
+//! @brief Upper bound on the serialised size of the values of an export list, exporting each type once.
+template <typename... Ts, size_t hood>
+struct export_size<common::type_sequence<Ts...>, hood> : export_size<export_calls<common::type_sequence<Ts...>, 1>, hood> {};
+
+
+/**
+ * @brief Upper bounds on the serialised size of the export lists `Ls` of a set of aggregate functions.
+ *
+ * The overall bound `value` sums the bounds of the functions, since the entries of their
+ * calls add up in the containers of the types they share (whose headers are counted more than once).
+ */
+template <size_t hood, typename... Ls>
+struct export_report : std::integral_constant<size_t, details::size_sum(export_size<Ls, hood>::value...)> {
+    //! @brief Prints the bound of every function, given their comma-separated names.
+    static void print(std::ostream& o, char const* names) {
+        size_t sizes[] = {export_size<Ls, hood>::value...};
+        for (size_t i = 0; i < sizeof...(Ls); ++i) {
+            while (*names == ' ' or *names == ',') ++names;
+            int depth = 0;
+            for (; *names and (depth > 0 or *names != ','); ++names) {
+                depth += (*names == '<') - (*names == '>');
+                o << *names;
+            }
+            o << " " << sizes[i] << std::endl;
+        }
+        o << "total " << export_report::value << std::endl;
+    }
+};
+
+//! @brief Declares a type `name` bounding the exports of a list of aggregate functions, printable through `name::print(ostream)`.
+#define FCPP_EXPORT_REPORT(name, hood, ...)                                     \
+    struct name : fcpp::export_report<hood, __VA_ARGS__> {                      \
+        static void print(std::ostream& o) {                                    \
+            fcpp::export_report<hood, __VA_ARGS__>::print(o, #__VA_ARGS__);     \
+        }                                                                       \
+    }
+
+
+}
+
+#endif // FCPP_MIOSIX_EXPORT_SIZE_H_
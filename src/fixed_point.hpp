@@ -0,0 +1,491 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file fixed_point.hpp
+ * @brief Fixed-point numbers, to be used as times and reals on microcontrollers without FPU.
+ *
+ * This header does not depend on the FCPP library, so that it can be force-included before it
+ * in order to configure its settings, as in the `FIXED_POINT=1` build:
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~{.sh}
+ * -include src/fixed_point.hpp -DFCPP_REAL_TYPE=fcpp::fixed_real -DFCPP_TIME_TYPE=fcpp::fixed_time
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+
+#ifndef FCPP_MIOSIX_FIXED_POINT_H_
+#define FCPP_MIOSIX_FIXED_POINT_H_
+
+#include <cmath>
+#include <cstdint>
+
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+/**
+ * @brief Fixed-point number stored in a signed integer `I`, with `F` fractional bits.
+ *
+ * Numbers convert implicitly from arithmetic types and explicitly to them. Arithmetic
+ * saturates to the largest and lowest values, which act as infinities. Multiplication and
+ * division round towards zero. Functions not computable exactly in integer arithmetic
+ * (as `pow` or `exp`) fall back to floating point.
+ */
+template <typename I, int F>
+class fixed {
+    static_assert(std::is_integral<I>::value and std::is_signed<I>::value, "fixed-point numbers must be stored in signed integers");
+    static_assert(F > 0 and F < int(sizeof(I) * 8) - 1, "fixed-point numbers must have fractional and integral bits");
+
+  public:
+    //! @brief The underlying integral type.
+    using value_type = I;
+
+    //! @brief Number of fractional bits.
+    static constexpr int fractional_bits = F;
+
+    //! @brief The representation of one.
+    static constexpr I one = I(1) << F;
+
+    //! @brief Default constructor (zero).
+    constexpr fixed() = default;
+
+    //! @brief Conversion from integral types (saturating).
+    template <typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+    constexpr fixed(T x) : m_value(from_integral(x)) {}
+
+    //! @brief Conversion from floating point types (rounding and saturating).
+    template <typename T, std::enable_if_t<std::is_floating_point<T>::value, int> = 0>
+    constexpr fixed(T x) : m_value(from_floating(x)) {}
+
+    //! @brief Fixed-point number with a given representation.
+    static constexpr fixed raw(I v) {
+        fixed x;
+        x.m_value = v;
+        return x;
+    }
+
+    //! @brief The representation.
+    constexpr I value() const {
+        return m_value;
+    }
+
+    //! @brief Conversion to booleans.
+    explicit constexpr operator bool() const {
+        return m_value != 0;
+    }
+
+    //! @brief Conversion to integral types (truncating towards zero).
+    template <typename T, std::enable_if_t<std::is_integral<T>::value and not std::is_same<T, bool>::value, int> = 0>
+    explicit constexpr operator T() const {
+        return T(m_value / one);
+    }
+
+    //! @brief Conversion to floating point types.
+    template <typename T, std::enable_if_t<std::is_floating_point<T>::value, int> = 0>
+    explicit constexpr operator T() const {
+        return T(m_value) / T(one);
+    }
+
+    //! @brief Unary plus.
+    constexpr fixed operator+() const {
+        return *this;
+    }
+
+    //! @brief Unary minus.
+    constexpr fixed operator-() const {
+        return raw(m_value == lowest_value ? highest_value : -m_value);
+    }
+
+    //! @brief Addition.
+    friend constexpr fixed operator+(fixed a, fixed b) {
+        I r = 0;
+        if (__builtin_add_overflow(a.m_value, b.m_value, &r)) return raw(b.m_value > 0 ? highest_value : lowest_value);
+        return raw(r);
+    }
+
+    //! @brief Subtraction.
+    friend constexpr fixed operator-(fixed a, fixed b) {
+        I r = 0;
+        if (__builtin_sub_overflow(a.m_value, b.m_value, &r)) return raw(b.m_value < 0 ? highest_value : lowest_value);
+        return raw(r);
+    }
+
+    //! @brief Multiplication.
+    friend constexpr fixed operator*(fixed a, fixed b) {
+        return raw(multiply(a.m_value, b.m_value));
+    }
+
+    //! @brief Division.
+    friend constexpr fixed operator/(fixed a, fixed b) {
+        return raw(divide(a.m_value, b.m_value));
+    }
+
+    //! @brief Remainder of the division (with the sign of the dividend).
+    friend constexpr fixed operator%(fixed a, fixed b) {
+        return raw(b.m_value == 0 ? 0 : a.m_value % b.m_value);
+    }
+
+    //! @brief Compound addition.
+    constexpr fixed& operator+=(fixed o) {
+        return *this = *this + o;
+    }
+
+    //! @brief Compound subtraction.
+    constexpr fixed& operator-=(fixed o) {
+        return *this = *this - o;
+    }
+
+    //! @brief Compound multiplication.
+    constexpr fixed& operator*=(fixed o) {
+        return *this = *this * o;
+    }
+
+    //! @brief Compound division.
+    constexpr fixed& operator/=(fixed o) {
+        return *this = *this / o;
+    }
+
+    //! @brief Equality operator.
+    friend constexpr bool operator==(fixed a, fixed b) {
+        return a.m_value == b.m_value;
+    }
+
+    //! @brief Inequality operator.
+    friend constexpr bool operator!=(fixed a, fixed b) {
+        return a.m_value != b.m_value;
+    }
+
+    //! @brief Less-than operator.
+    friend constexpr bool operator<(fixed a, fixed b) {
+        return a.m_value < b.m_value;
+    }
+
+    //! @brief Less-or-equal operator.
+    friend constexpr bool operator<=(fixed a, fixed b) {
+        return a.m_value <= b.m_value;
+    }
+
+    //! @brief Greater-than operator.
+    friend constexpr bool operator>(fixed a, fixed b) {
+        return a.m_value > b.m_value;
+    }
+
+    //! @brief Greater-or-equal operator.
+    friend constexpr bool operator>=(fixed a, fixed b) {
+        return a.m_value >= b.m_value;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        return s & m_value;
+    }
+
+    //! @brief Serialises the content to a given output stream.
+    template <typename S>
+    S& serialize(S& s) const {
+        return s << m_value;
+    }
+
+  private:
+    //! @brief Unsigned integral type of the same size.
+    using U = std::make_unsigned_t<I>;
+
+    //! @brief The largest representation.
+    static constexpr I highest_value = std::numeric_limits<I>::max();
+
+    //! @brief The lowest representation.
+    static constexpr I lowest_value = std::numeric_limits<I>::min();
+
+    //! @brief Representation of an integral value.
+    template <typename T>
+    static constexpr I from_integral(T x) {
+        if (std::is_signed<T>::value and x < 0) return (long long)x < (long long)(lowest_value / one) ? lowest_value : I(x) * one;
+        return (unsigned long long)x > (unsigned long long)(highest_value / one) ? highest_value : I(x) * one;
+    }
+
+    //! @brief Representation of a floating point value.
+    template <typename T>
+    static constexpr I from_floating(T x) {
+        if (x != x) return 0;
+        long double y = (long double)x * one;
+        if (y >= (long double)highest_value) return highest_value;
+        if (y <= (long double)lowest_value) return lowest_value;
+        return y < 0 ? I(y - 0.5) : I(y + 0.5);
+    }
+
+    //! @brief Saturates the magnitude of a result with a given sign.
+    static constexpr I saturate(unsigned long long r, bool negative) {
+        if (negative) return r > (unsigned long long)highest_value + 1 ? lowest_value : I(0 - U(r));
+        return r > (unsigned long long)highest_value ? highest_value : I(r);
+    }
+
+    //! @brief Magnitude of a representation.
+    static constexpr unsigned long long magnitude(I x) {
+        return x < 0 ? 0 - (unsigned long long)x : (unsigned long long)x;
+    }
+
+    //! @brief Product of representations.
+    static constexpr I multiply(I a, I b) {
+        bool negative = (a < 0) != (b < 0);
+        unsigned long long ua = magnitude(a), ub = magnitude(b);
+        if (sizeof(I) <= 4) return saturate((ua * ub) >> F, negative);
+        // full 128-bit product from 32-bit halves, then shifted
+        uint64_t al = ua & 0xFFFFFFFFu, ah = ua >> 32, bl = ub & 0xFFFFFFFFu, bh = ub >> 32;
+        uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+        uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFFu) + (hl & 0xFFFFFFFFu);
+        uint64_t lo = (ll & 0xFFFFFFFFu) | (mid << 32);
+        uint64_t hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+        if ((hi >> F) != 0) return negative ? lowest_value : highest_value;
+        return saturate((lo >> F) | (hi << (64 - F)), negative);
+    }
+
+    //! @brief Quotient of representations.
+    static constexpr I divide(I a, I b) {
+        bool negative = (a < 0) != (b < 0);
+        if (b == 0) return a == 0 ? 0 : negative ? lowest_value : highest_value;
+        unsigned long long ua = magnitude(a), ub = magnitude(b);
+        if (sizeof(I) <= 4 or (ua >> (63 - F)) == 0) return saturate((ua << F) / ub, negative);
+        // the shifted dividend exceeds 64 bits: the integral part of the quotient is divided first,
+        // then the fractional bits in chunks as wide as the divisor leaves room for (one chunk if below 2^40)
+        uint64_t q = ua / ub, r = ua % ub;
+        if ((q >> (63 - F)) != 0) return negative ? lowest_value : highest_value;
+        int room = (ub >> 63) != 0 ? 1 : __builtin_clzll(ub);
+        for (int bits = F; bits > 0; ) {
+            int k = bits < room ? bits : room;
+            r <<= k;
+            q = (q << k) | (r / ub);
+            r %= ub;
+            bits -= k;
+        }
+        return saturate(q, negative);
+    }
+
+    //! @brief The representation.
+    I m_value = 0;
+};
+
+
+//! @brief Fixed-point type for times, in seconds with a resolution of about 60ns and a range of about 17000 years.
+using fixed_time = fixed<int64_t, 24>;
+
+//! @brief Fixed-point type for reals (the same as times, so that they can be freely mixed).
+using fixed_real = fixed_time;
+
+
+//! @brief Absolute value.
+template <typename I, int F>
+constexpr fixed<I, F> abs(fixed<I, F> x) {
+    return x < 0 ? -x : x;
+}
+
+//! @brief Absolute value.
+template <typename I, int F>
+constexpr fixed<I, F> fabs(fixed<I, F> x) {
+    return abs(x);
+}
+
+//! @brief Largest integral value not greater than a number.
+template <typename I, int F>
+constexpr fixed<I, F> floor(fixed<I, F> x) {
+    return fixed<I, F>::raw(x.value() - (x.value() & (fixed<I, F>::one - 1)));
+}
+
+//! @brief Smallest integral value not lower than a number.
+template <typename I, int F>
+constexpr fixed<I, F> ceil(fixed<I, F> x) {
+    return -floor(-x);
+}
+
+//! @brief Integral value closest to a number (rounding halfway cases away from zero).
+template <typename I, int F>
+constexpr fixed<I, F> round(fixed<I, F> x) {
+    return x < 0 ? -floor(-x + fixed<I, F>::raw(fixed<I, F>::one / 2)) : floor(x + fixed<I, F>::raw(fixed<I, F>::one / 2));
+}
+
+//! @brief Integral value closest to a number, not greater in magnitude.
+template <typename I, int F>
+constexpr fixed<I, F> trunc(fixed<I, F> x) {
+    return x < 0 ? -floor(-x) : floor(x);
+}
+
+//! @brief Remainder of the division.
+template <typename I, int F>
+constexpr fixed<I, F> fmod(fixed<I, F> x, fixed<I, F> y) {
+    return x % y;
+}
+
+//! @brief Square root (computed bitwise on the representation).
+template <typename I, int F>
+fixed<I, F> sqrt(fixed<I, F> x) {
+    if (x.value() <= 0) return 0;
+    using U = std::make_unsigned_t<I>;
+    constexpr int bits = sizeof(I) * 8;
+    // the result is the root of the representation shifted by F bits, which may not fit:
+    // the representation is shifted as much as possible, and the root shifted by the rest
+    U v = U(x.value()) << (F & 1);
+    int rest = F - (F & 1);
+    while (rest > 0 and (v >> (bits - 2)) == 0) {
+        v <<= 2;
+        rest -= 2;
+    }
+    U r = 0;
+    for (U bit = U(1) << (bits - 2); bit > 0; bit >>= 2) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else r >>= 1;
+    }
+    return fixed<I, F>::raw(I(r << (rest / 2)));
+}
+
+//! @brief Power (computed in floating point).
+template <typename I, int F>
+fixed<I, F> pow(fixed<I, F> x, fixed<I, F> y) {
+    return std::pow(double(x), double(y));
+}
+
+//! @brief Exponential (computed in floating point).
+template <typename I, int F>
+fixed<I, F> exp(fixed<I, F> x) {
+    return std::exp(double(x));
+}
+
+//! @brief Natural logarithm (computed in floating point).
+template <typename I, int F>
+fixed<I, F> log(fixed<I, F> x) {
+    return std::log(double(x));
+}
+
+//! @brief Base-10 logarithm (computed in floating point).
+template <typename I, int F>
+fixed<I, F> log10(fixed<I, F> x) {
+    return std::log10(double(x));
+}
+
+//! @brief Complementary error function (computed in floating point).
+template <typename I, int F>
+fixed<I, F> erfc(fixed<I, F> x) {
+    return std::erfc(double(x));
+}
+
+//! @brief Whether a number is not a number (never).
+template <typename I, int F>
+constexpr bool isnan(fixed<I, F>) {
+    return false;
+}
+
+//! @brief Whether a number is saturated to an infinity.
+template <typename I, int F>
+constexpr bool isinf(fixed<I, F> x) {
+    return x.value() >= std::numeric_limits<I>::max() or x.value() <= -std::numeric_limits<I>::max();
+}
+
+//! @brief Whether a number is finite.
+template <typename I, int F>
+constexpr bool isfinite(fixed<I, F> x) {
+    return not isinf(x);
+}
+
+
+/**
+ * @brief Printing a fixed-point number in decimal, without floating point.
+ *
+ * At most `o.precision()` decimals are printed (up to 9), omitting trailing zeros as in the
+ * default format of floating point numbers, and saturated numbers are printed as infinities.
+ */
+template <typename I, int F>
+std::ostream& operator<<(std::ostream& o, fixed<I, F> x) {
+    if (isinf(x)) return o << (x < 0 ? "-inf" : "inf");
+    unsigned long long v = x.value() < 0 ? 0 - (unsigned long long)x.value() : (unsigned long long)x.value();
+    unsigned long long ip = v >> F, fp = v & ((1ULL << F) - 1);
+    int digits = o.precision() < 9 ? int(o.precision()) : 9;
+    unsigned long long scale = 1;
+    for (int i = 0; i < digits; ++i) scale *= 10;
+    // fp * scale may exceed 64 bits for many fractional bits: split the product
+    unsigned long long dec = (fp >> (F/2)) * scale + (((fp & ((1ULL << (F/2)) - 1)) * scale) >> (F/2));
+    dec = (dec + (1ULL << (F - F/2 - 1))) >> (F - F/2);
+    if (dec >= scale) {
+        ++ip;
+        dec -= scale;
+    }
+    if (x.value() < 0 and (ip > 0 or dec > 0)) o << '-';
+    o << ip;
+    if (dec == 0) return o;
+    while (dec % 10 == 0) {
+        dec /= 10;
+        --digits;
+    }
+    char buf[10];
+    for (int i = digits - 1; i >= 0; --i, dec /= 10) buf[i] = char('0' + dec % 10);
+    buf[digits] = 0;
+    return o << '.' << buf;
+}
+
+//! @brief Reading a fixed-point number (through floating point).
+template <typename I, int F>
+std::istream& operator>>(std::istream& i, fixed<I, F>& x) {
+    double d;
+    if (i >> d) x = d;
+    return i;
+}
+
+
+}
+
+
+//! @brief Limits of fixed-point numbers, whose largest and lowest values act as infinities.
+template <typename I, int F>
+struct std::numeric_limits<fcpp::fixed<I, F>> {
+    using T = fcpp::fixed<I, F>;
+
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = true;
+    static constexpr bool has_infinity = true;
+    static constexpr bool has_quiet_NaN = false;
+    static constexpr bool has_signaling_NaN = false;
+    static constexpr bool is_bounded = true;
+    static constexpr bool is_modulo = false;
+    static constexpr int radix = 2;
+    static constexpr int digits = std::numeric_limits<I>::digits;
+    static constexpr int digits10 = std::numeric_limits<I>::digits10;
+    static constexpr float_round_style round_style = round_toward_zero;
+
+    static constexpr T min() noexcept {
+        return T::raw(1);
+    }
+    static constexpr T lowest() noexcept {
+        return T::raw(std::numeric_limits<I>::min());
+    }
+    static constexpr T max() noexcept {
+        return T::raw(std::numeric_limits<I>::max());
+    }
+    static constexpr T epsilon() noexcept {
+        return T::raw(1);
+    }
+    static constexpr T round_error() noexcept {
+        return T::raw(T::one / 2);
+    }
+    static constexpr T infinity() noexcept {
+        return max();
+    }
+    static constexpr T quiet_NaN() noexcept {
+        return T();
+    }
+    static constexpr T signaling_NaN() noexcept {
+        return T();
+    }
+    static constexpr T denorm_min() noexcept {
+        return min();
+    }
+};
+
+#endif // FCPP_MIOSIX_FIXED_POINT_H_
@@ -0,0 +1,373 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file flash_log.hpp
+ * @brief Persistent circular log of rows, written in whole blocks on a flash-like block device.
+ */
+
+#ifndef FCPP_MIOSIX_FLASH_LOG_H_
+#define FCPP_MIOSIX_FLASH_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <ostream>
+#include <vector>
+
+#include "crc.hpp"
+#include "row_log.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+//! @brief Counters of the flash log activity.
+struct flash_log_stats {
+    //! @brief Blocks found valid by the recovery scan at boot.
+    uint32_t recovered = 0;
+    //! @brief Blocks written.
+    uint32_t written = 0;
+    //! @brief Blocks skipped as worn out.
+    uint32_t worn = 0;
+    //! @brief Block erases or writes failed.
+    uint32_t errors = 0;
+    //! @brief Blocks whose content was found corrupted while reading.
+    uint32_t corrupted = 0;
+};
+
+//! @brief The flash log counters since boot.
+inline flash_log_stats& flash_log_counters() {
+    static flash_log_stats s;
+    return s;
+}
+
+
+/**
+ * @brief Block device emulated in a file, as a sequence of `block_count` blocks of `block_size` bytes.
+ *
+ * Can be used on the host, or on a device with a filesystem. Other block devices (as a raw
+ * flash driver) can be used in its place, providing the same `block_size`, `block_count`,
+ * `read`, `write` and `erase` members.
+ */
+class file_block_device {
+  public:
+    //! @brief Constructor, opening (and creating if needed) the file.
+    file_block_device(char const* path, size_t block_size, size_t block_count) : m_block_size(block_size), m_block_count(block_count) {
+        m_file = std::fopen(path, "r+b");
+        if (m_file == nullptr) m_file = std::fopen(path, "w+b");
+        if (m_file == nullptr) return;
+        std::fseek(m_file, 0, SEEK_END);
+        long size = std::ftell(m_file);
+        for (long i = size; i < long(block_size * block_count); ++i) std::fputc(0xFF, m_file);
+        std::fflush(m_file);
+    }
+
+    //! @brief Destructor, closing the file.
+    ~file_block_device() {
+        if (m_file != nullptr) std::fclose(m_file);
+    }
+
+    file_block_device(file_block_device const&) = delete;
+    file_block_device& operator=(file_block_device const&) = delete;
+
+    //! @brief Whether the file could be opened.
+    bool good() const {
+        return m_file != nullptr;
+    }
+
+    //! @brief The size of blocks in bytes.
+    size_t block_size() const {
+        return m_block_size;
+    }
+
+    //! @brief The number of blocks.
+    size_t block_count() const {
+        return m_block_count;
+    }
+
+    //! @brief Reads bytes from a block.
+    bool read(size_t block, size_t offset, void* data, size_t size) {
+        if (not seek(block, offset, size)) return false;
+        return std::fread(data, 1, size, m_file) == size;
+    }
+
+    //! @brief Writes bytes into an erased block.
+    bool write(size_t block, size_t offset, void const* data, size_t size) {
+        if (not seek(block, offset, size)) return false;
+        bool ok = std::fwrite(data, 1, size, m_file) == size;
+        return std::fflush(m_file) == 0 and ok;
+    }
+
+    //! @brief Erases a block (setting all its bytes to 0xFF).
+    bool erase(size_t block) {
+        if (not seek(block, 0, m_block_size)) return false;
+        for (size_t i = 0; i < m_block_size; ++i) std::fputc(0xFF, m_file);
+        return std::fflush(m_file) == 0;
+    }
+
+  private:
+    //! @brief Moves to a position in a block, checking bounds.
+    bool seek(size_t block, size_t offset, size_t size) {
+        if (m_file == nullptr or block >= m_block_count or offset + size > m_block_size) return false;
+        return std::fseek(m_file, long(block * m_block_size + offset), SEEK_SET) == 0;
+    }
+
+    //! @brief The file.
+    std::FILE* m_file;
+    //! @brief The size of blocks in bytes.
+    size_t m_block_size;
+    //! @brief The number of blocks.
+    size_t m_block_count;
+};
+
+
+/**
+ * @brief Circular log of blocks on a block device `D`, surviving reboots.
+ *
+ * Every block starts with a header holding a sequence number, the number of times the
+ * block has been erased and checksums of header and content. The header is written after
+ * the content, so that interrupted writes leave the block invalid. At construction, the
+ * headers are scanned to resume after the most recent block. Blocks are rotated in order,
+ * so that they wear evenly, and blocks erased at least `endurance` times (if not zero) or
+ * failing to be written are skipped.
+ */
+template <typename D>
+class flash_ring {
+  public:
+    //! @brief The size in bytes of block headers.
+    static constexpr size_t header_size = 24;
+
+    //! @brief Constructor, recovering the state of the log from the device.
+    flash_ring(D& device, uint32_t endurance = 0) : m_device(device), m_endurance(endurance) {
+        header h;
+        bool found = false;
+        for (size_t b = 0; b < m_device.block_count(); ++b) {
+            if (not read_header(b, h)) continue;
+            ++flash_log_counters().recovered;
+            if (h.erases > m_max_erases) m_max_erases = h.erases;
+            if (not found or int32_t(h.seq - m_seq) > 0) {
+                m_seq = h.seq;
+                m_next = (b + 1) % m_device.block_count();
+                found = true;
+            }
+        }
+    }
+
+    //! @brief The maximum size of the content of a block.
+    size_t payload_size() const {
+        return m_device.block_size() - header_size;
+    }
+
+    //! @brief Appends a block with a given content, overwriting the oldest one (false if no block could be written).
+    bool append(void const* data, size_t size) {
+        if (size > payload_size()) return false;
+        for (size_t i = 0; i < m_device.block_count(); ++i) {
+            size_t b = m_next;
+            m_next = (m_next + 1) % m_device.block_count();
+            header h;
+            uint32_t erases = read_header(b, h) ? h.erases : m_max_erases;
+            if (m_endurance > 0 and erases >= m_endurance) {
+                ++flash_log_counters().worn;
+                continue;
+            }
+            h = {m_seq + 1, erases + 1, uint32_t(size), crc32(data, size)};
+            uint8_t buf[header_size];
+            h.write(buf);
+            if (m_device.erase(b) and m_device.write(b, header_size, data, size) and m_device.write(b, 0, buf, header_size) and read_header(b, h)) {
+                ++m_seq;
+                if (h.erases > m_max_erases) m_max_erases = h.erases;
+                ++flash_log_counters().written;
+                return true;
+            }
+            ++flash_log_counters().errors;
+        }
+        return false;
+    }
+
+    //! @brief Calls `f(data, size)` on the content of every valid block, from the oldest to the most recent.
+    template <typename F>
+    void for_each(F&& f) const {
+        std::vector<char> data(payload_size());
+        header h;
+        for (size_t i = 0; i < m_device.block_count(); ++i) {
+            size_t b = (m_next + i) % m_device.block_count();
+            if (not read_header(b, h)) continue;
+            if (not m_device.read(b, header_size, data.data(), h.size) or crc32(data.data(), h.size) != h.crc) {
+                ++flash_log_counters().corrupted;
+                continue;
+            }
+            f(data.data(), size_t(h.size));
+        }
+    }
+
+    //! @brief The maximum number of times a block has been erased.
+    uint32_t max_erases() const {
+        return m_max_erases;
+    }
+
+  private:
+    //! @brief Marker identifying block headers.
+    static constexpr uint32_t magic = 0x464C4731;
+
+    //! @brief The header of a block.
+    struct header {
+        //! @brief Sequence number of the block.
+        uint32_t seq;
+        //! @brief Number of times the block has been erased.
+        uint32_t erases;
+        //! @brief Size of the content.
+        uint32_t size;
+        //! @brief Checksum of the content.
+        uint32_t crc;
+
+        //! @brief Writes the header into a buffer, in little endian.
+        void write(uint8_t* buf) const {
+            uint32_t v[] = {magic, seq, erases, size, crc};
+            for (size_t i = 0; i < 5; ++i)
+                for (size_t j = 0; j < 4; ++j)
+                    buf[4*i+j] = uint8_t(v[i] >> (8*j));
+            uint32_t c = crc32(buf, 20);
+            for (size_t j = 0; j < 4; ++j) buf[20+j] = uint8_t(c >> (8*j));
+        }
+
+        //! @brief Reads the header from a buffer (false if not valid).
+        bool read(uint8_t const* buf) {
+            uint32_t v[6];
+            for (size_t i = 0; i < 6; ++i) {
+                v[i] = 0;
+                for (size_t j = 0; j < 4; ++j) v[i] |= uint32_t(buf[4*i+j]) << (8*j);
+            }
+            if (v[0] != magic or v[5] != crc32(buf, 20)) return false;
+            seq = v[1];
+            erases = v[2];
+            size = v[3];
+            crc = v[4];
+            return true;
+        }
+    };
+
+    //! @brief Reads the header of a block (false if not valid).
+    bool read_header(size_t block, header& h) const {
+        uint8_t buf[header_size];
+        return m_device.read(block, 0, buf, header_size) and h.read(buf) and h.size <= payload_size();
+    }
+
+    //! @brief The block device.
+    D& m_device;
+    //! @brief Maximum number of erases of a block (zero for no limit).
+    uint32_t m_endurance;
+    //! @brief Maximum number of erases of a block found.
+    uint32_t m_max_erases = 0;
+    //! @brief Sequence number of the last block written.
+    uint32_t m_seq = 0;
+    //! @brief The next block to be written.
+    size_t m_next = 0;
+};
+
+
+}
+
+
+//! @brief Namespace for plotting and logging facilities.
+namespace plot {
+
+
+/**
+ * @brief Row store with a time column `T` followed by the columns in `S`, persisted on a block device `D`.
+ *
+ * Rows are encoded as in `compressed_rows` into a RAM block of `block_size` bytes (header
+ * included), which is appended to a `flash_ring` when full or on `flush()`. Printing decodes
+ * the rows of all the blocks on the device (including ones written before a reboot), followed
+ * by the rows not yet flushed.
+ */
+template <typename T, typename S, typename D, size_t block_size>
+class flash_rows {
+  public:
+    //! @brief Number of bytes reserved for the rows not yet persisted, which never grow past a block.
+    static constexpr size_t buffer_size = block_size - os::flash_ring<D>::header_size;
+
+    //! @brief Constructor, recovering the log on a device (whose blocks must be of `block_size` bytes).
+    flash_rows(D& device, uint32_t endurance = 0) : m_ring(device, endurance) {}
+
+    //! @brief Stores a row (given as a tagged tuple including the columns).
+    template <typename R>
+    flash_rows& operator<<(R const& row) {
+        m_stage << row;
+        if (m_stage.dropped() > 0 and m_stage.size() > 0) {
+            flush();
+            m_stage << row;
+        }
+        if (m_stage.dropped() > 0) {
+            m_stage.clear();
+            ++m_dropped;
+        } else ++m_rows;
+        return *this;
+    }
+
+    //! @brief Writes the rows not yet persisted into a block.
+    void flush() {
+        if (m_stage.size() == 0) return;
+        if (not m_ring.append(m_stage.data().data(), m_stage.byte_size())) m_dropped += m_stage.size();
+        m_stage.clear();
+    }
+
+    //! @brief Number of bytes used by rows not yet persisted.
+    size_t byte_size() const {
+        return m_stage.byte_size();
+    }
+
+    //! @brief Number of rows stored since boot.
+    size_t size() const {
+        return m_rows;
+    }
+
+    //! @brief Number of rows dropped since boot.
+    size_t dropped() const {
+        return m_dropped;
+    }
+
+    //! @brief Calls `f(data, size)` on every block of encoded rows, from the oldest.
+    template <typename F>
+    void for_each_block(F&& f) const {
+        m_ring.for_each(f);
+        f(m_stage.data().data(), m_stage.byte_size());
+    }
+
+    //! @brief Prints the rows, decoding them one block at a time.
+    void print(std::ostream& o) const {
+        stage_type::print_header(o);
+        for_each_block([&](char const* data, size_t size){
+            stage_type::decode(o, data, size);
+        });
+        if (m_dropped > 0) o << "# " << m_dropped << " rows dropped" << std::endl;
+    }
+
+  private:
+    //! @brief The type of the store of rows not yet persisted.
+    using stage_type = compressed_rows<T, S, buffer_size>;
+
+    //! @brief The persisted blocks.
+    os::flash_ring<D> m_ring;
+    //! @brief The rows not yet persisted.
+    stage_type m_stage;
+    //! @brief Number of rows stored since boot.
+    size_t m_rows = 0;
+    //! @brief Number of rows dropped since boot.
+    size_t m_dropped = 0;
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_FLASH_LOG_H_
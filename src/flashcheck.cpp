@@ -0,0 +1,189 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lib/settings.hpp"
+#include "lib/common/tagged_tuple.hpp"
+
+#include "flash_log.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+    //! @brief Tags of the columns of the checked rows.
+    namespace tags {
+        //! @brief Time of a row.
+        struct row_time {};
+        //! @brief A small integer.
+        struct row_count {};
+    }
+
+    //! @brief The file emulating the flash device.
+    constexpr char const* flash_file = "flashcheck.log";
+
+    //! @brief Size of the blocks of the device.
+    constexpr size_t block_size = 128;
+
+    //! @brief Number of blocks of the device.
+    constexpr size_t block_count = 8;
+
+    //! @brief The ring checked.
+    using ring_type = os::flash_ring<os::file_block_device>;
+
+    //! @brief Row store persisted on the device.
+    using rows_type = plot::flash_rows<tags::row_time, component::tags::tuple_store<tags::row_count, int>, os::file_block_device, block_size>;
+
+    //! @brief The contents of the blocks of a ring, from the oldest.
+    inline std::vector<std::string> contents(ring_type const& ring) {
+        std::vector<std::string> res;
+        ring.for_each([&](char const* data, size_t size){
+            res.emplace_back(data, size);
+        });
+        return res;
+    }
+
+    //! @brief The contents expected for the blocks from `first` to `last` (excluded).
+    inline std::vector<std::string> expected(int first, int last) {
+        std::vector<std::string> res;
+        for (int i = first; i < last; ++i) res.push_back("block " + std::to_string(i));
+        return res;
+    }
+
+    //! @brief Appends the blocks from `first` to `last` (excluded), returning whether all were written.
+    inline bool append(ring_type& ring, int first, int last) {
+        bool ok = true;
+        for (int i = first; i < last; ++i) {
+            std::string s = "block " + std::to_string(i);
+            ok = ring.append(s.data(), s.size()) and ok;
+        }
+        return ok;
+    }
+
+    //! @brief Overwrites a byte of the device file.
+    inline void poke(size_t offset, int value) {
+        std::FILE* f = std::fopen(flash_file, "r+b");
+        std::fseek(f, long(offset), SEEK_SET);
+        std::fputc(value, f);
+        std::fclose(f);
+    }
+
+    //! @brief The rows printed by a row store (without comment lines).
+    inline std::vector<std::string> printed_rows(rows_type const& rows) {
+        std::stringstream ss;
+        rows.print(ss);
+        std::vector<std::string> res;
+        std::string line;
+        while (std::getline(ss, line)) if (not line.empty() and line[0] != '#') res.push_back(line);
+        return res;
+    }
+}
+
+
+/**
+ * @brief Checks the persistent circular log on a file-backed block device.
+ *
+ * Blocks are appended, recovered after simulated reboots (reopening the device), overwritten
+ * when the ring wraps around, and skipped when their header is torn, their content corrupted
+ * or they are worn out. Rows persisted by `flash_rows` are also checked to survive a reboot.
+ * Returns non-zero on failure.
+ */
+int main() {
+    using namespace fcpp;
+
+    int failures = 0;
+    auto check = [&](bool ok, char const* what) {
+        if (not ok) {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    };
+    std::remove(flash_file);
+
+    {
+        os::file_block_device device(flash_file, block_size, block_count);
+        check(device.good(), "device file opened");
+        ring_type ring(device);
+        check(append(ring, 0, 5), "blocks appended");
+        check(contents(ring) == expected(0, 5), "blocks read back");
+    }
+    {
+        os::flash_log_counters() = {};
+        os::file_block_device device(flash_file, block_size, block_count);
+        ring_type ring(device);
+        check(os::flash_log_counters().recovered == 5, "blocks recovered after a reboot");
+        check(contents(ring) == expected(0, 5), "blocks read back after a reboot");
+        check(append(ring, 5, 25), "blocks appended past the end of the ring");
+        check(contents(ring) == expected(17, 25), "oldest blocks overwritten");
+    }
+    {
+        os::file_block_device device(flash_file, block_size, block_count);
+        ring_type ring(device);
+        check(contents(ring) == expected(17, 25), "blocks read back after wrapping around and rebooting");
+        check(append(ring, 25, 26), "block appended after wrapping around and rebooting");
+        check(contents(ring) == expected(18, 26), "oldest block overwritten after rebooting");
+        // blocks found blank are counted as erased as the most erased one: the last device block was written with 8, 9 and 10 erases
+        check(ring.max_erases() == 10, "erases counted");
+    }
+    {
+        // block 25 was written in the second block of the device: tearing its header simulates a power loss while writing it
+        poke(block_size, 0xFF);
+        os::file_block_device device(flash_file, block_size, block_count);
+        ring_type ring(device);
+        check(contents(ring) == expected(18, 25), "torn block skipped");
+        check(append(ring, 26, 27), "block appended after a torn one");
+        std::vector<std::string> blocks = expected(18, 25);
+        blocks.push_back("block 26");
+        check(contents(ring) == blocks, "torn block overwritten");
+    }
+    {
+        // block 19 is in the fourth block of the device
+        poke(3 * block_size + ring_type::header_size + 2, 'X');
+        os::flash_log_counters() = {};
+        os::file_block_device device(flash_file, block_size, block_count);
+        ring_type ring(device);
+        std::vector<std::string> blocks = expected(18, 25);
+        blocks.push_back("block 26");
+        blocks.erase(blocks.begin() + 1);
+        check(contents(ring) == blocks and os::flash_log_counters().corrupted == 1, "corrupted block skipped");
+    }
+    {
+        os::flash_log_counters() = {};
+        os::file_block_device device(flash_file, block_size, block_count);
+        ring_type ring(device, 1);
+        check(not append(ring, 27, 28) and os::flash_log_counters().worn == block_count, "worn out blocks skipped");
+    }
+    std::remove(flash_file);
+
+    std::vector<std::string> lines;
+    {
+        os::file_block_device device(flash_file, block_size, block_count);
+        rows_type rows(device);
+        for (int i = 0; i < 200; ++i) {
+            rows << common::make_tagged_tuple<tags::row_time, tags::row_count>(times_t(i * 0.5), i / 7);
+            std::stringstream ss;
+            ss << i * 0.5 << " " << i / 7 << " ";
+            lines.push_back(ss.str());
+        }
+        rows.flush();
+        check(rows.size() == 200 and rows.dropped() == 0, "rows stored");
+        check(printed_rows(rows) == lines, "rows read back");
+    }
+    {
+        os::file_block_device device(flash_file, block_size, block_count);
+        rows_type rows(device);
+        check(printed_rows(rows) == lines, "rows recovered after a reboot");
+        rows << common::make_tagged_tuple<tags::row_time, tags::row_count>(times_t(1000), -1);
+        lines.push_back("1000 -1 ");
+        check(printed_rows(rows) == lines, "rows appended after a reboot");
+    }
+    std::remove(flash_file);
+    if (failures == 0) std::cout << "all checks passed" << std::endl;
+    return failures;
+}
@@ -0,0 +1,240 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file flat_map.hpp
+ * @brief Sorted associative container with fixed capacity, stored in place without allocations.
+ */
+
+#ifndef FCPP_MIOSIX_FLAT_MAP_H_
+#define FCPP_MIOSIX_FLAT_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Eviction policy discarding the entry with the smallest value (e.g., the oldest time).
+struct evict_min_value {
+    //! @brief The index of the entry to be evicted (`n` to reject the new key).
+    template <typename T, typename K>
+    size_t operator()(T const* data, size_t n, K const&) const {
+        return std::min_element(data, data + n, [](T const& x, T const& y){
+            return x.second < y.second;
+        }) - data;
+    }
+};
+
+//! @brief Eviction policy discarding the entry with the largest key, if larger than the new key.
+struct evict_max_key {
+    //! @brief The index of the entry to be evicted (`n` to reject the new key).
+    template <typename T, typename K>
+    size_t operator()(T const* data, size_t n, K const& k) const {
+        return k < data[n-1].first ? n-1 : n;
+    }
+};
+
+//! @brief Eviction policy rejecting new keys.
+struct evict_none {
+    //! @brief The index of the entry to be evicted (`n` to reject the new key).
+    template <typename T, typename K>
+    size_t operator()(T const*, size_t n, K const&) const {
+        return n;
+    }
+};
+
+
+/**
+ * @brief Map from keys `K` to values `V` holding at most `N` entries, sorted by key in a flat array.
+ *
+ * Follows the interface of `std::map` for the operations it supports. When inserting a key in
+ * a full map, the entry to be discarded is chosen by the eviction policy `E`; if the new key
+ * is rejected, `operator[]` returns a scratch value which is not part of the map.
+ */
+template <typename K, typename V, size_t N, typename E = evict_min_value>
+class flat_map {
+  public:
+    //! @brief The type of keys.
+    using key_type = K;
+    //! @brief The type of values.
+    using mapped_type = V;
+    //! @brief The type of entries.
+    using value_type = std::pair<K, V>;
+    //! @brief The type of sizes (the smallest fitting the capacity).
+    using size_type = std::conditional_t<N < 256, uint8_t, std::conditional_t<N < 65536, uint16_t, uint32_t>>;
+    //! @brief The iterator type.
+    using iterator = value_type*;
+    //! @brief The constant iterator type.
+    using const_iterator = value_type const*;
+
+    //! @brief The maximum number of entries.
+    static constexpr size_t capacity = N;
+
+    //! @name iterators
+    //! @{
+    iterator begin() {
+        return m_data;
+    }
+    const_iterator begin() const {
+        return m_data;
+    }
+    iterator end() {
+        return m_data + m_size;
+    }
+    const_iterator end() const {
+        return m_data + m_size;
+    }
+    //! @}
+
+    //! @brief The number of entries.
+    size_t size() const {
+        return m_size;
+    }
+
+    //! @brief Whether the map is empty.
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    //! @brief Removes all entries.
+    void clear() {
+        m_size = 0;
+    }
+
+    //! @brief The entry with a given key (`end()` if absent).
+    iterator find(K const& k) {
+        iterator it = lower_bound(k);
+        return it != end() and it->first == k ? it : end();
+    }
+
+    //! @brief The entry with a given key (`end()` if absent).
+    const_iterator find(K const& k) const {
+        const_iterator it = lower_bound(k);
+        return it != end() and it->first == k ? it : end();
+    }
+
+    //! @brief The number of entries with a given key (zero or one).
+    size_t count(K const& k) const {
+        return find(k) != end();
+    }
+
+    //! @brief The value of a key, inserted if absent.
+    V& operator[](K const& k) {
+        iterator it = lower_bound(k);
+        if (it != end() and it->first == k) return it->second;
+        if (m_size == N) {
+            size_t i = E{}(m_data, m_size, k);
+            if (i >= m_size) {
+                m_scratch = V{};
+                return m_scratch;
+            }
+            size_t j = it - m_data;
+            if (i < j) {
+                std::move(m_data + i + 1, it, m_data + i);
+                it = m_data + j - 1;
+            } else {
+                std::move_backward(it, m_data + i, m_data + i + 1);
+            }
+        } else {
+            std::move_backward(it, end(), end() + 1);
+            ++m_size;
+        }
+        it->first = k;
+        it->second = V{};
+        return it->second;
+    }
+
+    //! @brief Removes an entry, returning the following one.
+    iterator erase(const_iterator pos) {
+        iterator it = begin() + (pos - begin());
+        std::move(it + 1, end(), it);
+        --m_size;
+        return it;
+    }
+
+    //! @brief Removes the entry with a given key, returning the number of entries removed.
+    size_t erase(K const& k) {
+        iterator it = find(k);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    //! @brief Equality operator.
+    bool operator==(flat_map const& o) const {
+        return m_size == o.m_size and std::equal(begin(), end(), o.begin());
+    }
+
+    //! @brief Inequality operator.
+    bool operator!=(flat_map const& o) const {
+        return not (*this == o);
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        s & m_size;
+        if (m_size > N) m_size = N;
+        for (size_t i = 0; i < m_size; ++i)
+            s & m_data[i].first & m_data[i].second;
+        return s;
+    }
+
+    //! @brief Serialises the content to a given output stream.
+    template <typename S>
+    S& serialize(S& s) const {
+        s << m_size;
+        for (size_t i = 0; i < m_size; ++i)
+            s << m_data[i].first << m_data[i].second;
+        return s;
+    }
+
+  private:
+    //! @brief The first entry with a key not smaller than a given one.
+    iterator lower_bound(K const& k) {
+        return std::lower_bound(begin(), end(), k, [](value_type const& x, K const& y){
+            return x.first < y;
+        });
+    }
+
+    //! @brief The first entry with a key not smaller than a given one.
+    const_iterator lower_bound(K const& k) const {
+        return std::lower_bound(begin(), end(), k, [](value_type const& x, K const& y){
+            return x.first < y;
+        });
+    }
+
+    //! @brief The number of entries.
+    size_type m_size = 0;
+    //! @brief The entries, sorted by key.
+    value_type m_data[N];
+    //! @brief Value returned for rejected keys.
+    V m_scratch;
+};
+
+//! @brief Printing a flat map.
+template <typename K, typename V, size_t N, typename E>
+std::ostream& operator<<(std::ostream& o, flat_map<K,V,N,E> const& m) {
+    o << "{";
+    bool first = true;
+    for (auto const& x : m) {
+        if (not first) o << ", ";
+        first = false;
+        o << x.first << ":" << x.second;
+    }
+    return o << "}";
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_FLAT_MAP_H_
@@ -0,0 +1,185 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file fragmentation.hpp
+ * @brief Splitting of messages exceeding a radio frame into fragments, and their reassembly.
+ */
+
+#ifndef FCPP_MIOSIX_FRAGMENTATION_H_
+#define FCPP_MIOSIX_FRAGMENTATION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "lib/settings.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+//! @brief Counters of the fragmentation activity, for measuring its airtime cost (updated by the radio thread).
+struct fragment_stats {
+    //! @brief Fragments successfully broadcast.
+    std::atomic<uint32_t> sent{0};
+    //! @brief Fragments received.
+    std::atomic<uint32_t> received{0};
+    //! @brief Fragments missing from reassemblies which timed out or were evicted.
+    std::atomic<uint32_t> lost{0};
+    //! @brief Messages successfully reassembled.
+    std::atomic<uint32_t> reassembled{0};
+};
+
+//! @brief The fragmentation counters since boot.
+inline fragment_stats& fragment_counters() {
+    static fragment_stats s;
+    return s;
+}
+
+
+//! @brief Size of the header prefixed to every fragment (message sequence number, index and count).
+constexpr size_t fragment_header_size = 2;
+
+//! @brief Writes the header of a fragment.
+inline void write_fragment_header(char* p, uint8_t seq, size_t index, size_t count) {
+    p[0] = seq;
+    p[1] = (index << 4) | (count - 1);
+}
+
+
+/**
+ * @brief Reassembles fragmented messages from multiple senders.
+ *
+ * Up to `slots` messages are reassembled at the same time, each of them made of at most
+ * `max_fragments` fragments of `fragment_size` bytes (excluding the header). Incomplete
+ * messages are dropped after a timeout, or when room is needed for newer messages.
+ *
+ * @param fragment_size The size of the content of every fragment but the last.
+ * @param max_fragments The maximum number of fragments of a message (up to 16).
+ * @param slots The maximum number of messages under reassembly.
+ */
+template <size_t fragment_size, size_t max_fragments, size_t slots>
+class reassembler {
+    static_assert(max_fragments > 1 and max_fragments <= 16, "messages can be split in at most 16 fragments");
+
+  public:
+    //! @brief The maximum size of a reassembled message.
+    static constexpr size_t max_size = fragment_size * max_fragments;
+
+    //! @brief Constructor given the timeout for reassembly.
+    reassembler(times_t timeout) : m_timeout(timeout) {}
+
+    /**
+     * @brief Inserts a fragment (header included) received from a device.
+     *
+     * @return Whether the message is now complete: if so, `data` and `size` are set to its
+     *         content, which stays valid until the next call.
+     */
+    bool insert(device_t device, char const* fragment, size_t len, times_t now, char const*& data, size_t& size) {
+        if (len < fragment_header_size) return false;
+        uint8_t seq = fragment[0];
+        size_t index = uint8_t(fragment[1]) >> 4;
+        size_t count = (fragment[1] & 15) + 1;
+        len -= fragment_header_size;
+        if (index >= count or count > max_fragments or len > fragment_size or (index+1 < count and len < fragment_size)) return false;
+        fragment_counters().received.fetch_add(1, std::memory_order_relaxed);
+        expire(now);
+        entry* e = find(device, seq, count, now);
+        uint16_t bit = 1 << index;
+        if (e->mask & bit) return false;
+        e->mask |= bit;
+        memcpy(e->data + index * fragment_size, fragment + fragment_header_size, len);
+        if (index+1 == count) e->size = index * fragment_size + len;
+        if (e->mask + 1 != (1 << count)) return false;
+        e->used = false;
+        fragment_counters().reassembled.fetch_add(1, std::memory_order_relaxed);
+        data = e->data;
+        size = e->size;
+        return true;
+    }
+
+    //! @brief Drops the messages whose reassembly started before the timeout.
+    void expire(times_t now) {
+        for (entry& e : m_entries)
+            if (e.used and now - e.start > m_timeout)
+                drop(e);
+    }
+
+  private:
+    //! @brief A message under reassembly.
+    struct entry {
+        //! @brief Whether the entry is in use.
+        bool used = false;
+        //! @brief The sender.
+        device_t device;
+        //! @brief The sequence number of the message.
+        uint8_t seq;
+        //! @brief The number of fragments of the message.
+        uint8_t count;
+        //! @brief The fragments received so far.
+        uint16_t mask;
+        //! @brief The size of the message (known after the last fragment).
+        size_t size;
+        //! @brief When the first fragment was received.
+        times_t start;
+        //! @brief The message content.
+        char data[max_size];
+    };
+
+    //! @brief Releases an entry, accounting for its missing fragments.
+    void drop(entry& e) {
+        size_t received = 0;
+        for (uint16_t m = e.mask; m; m &= m - 1) ++received;
+        fragment_counters().lost.fetch_add(e.count - received, std::memory_order_relaxed);
+        e.used = false;
+    }
+
+    //! @brief Finds the entry of a message, starting one if needed (possibly evicting the oldest one).
+    entry* find(device_t device, uint8_t seq, size_t count, times_t now) {
+        entry* res = nullptr;
+        for (entry& e : m_entries) {
+            if (e.used and e.device == device) {
+                if (e.seq == seq and e.count == count) return &e;
+                // a newer message from the same device supersedes the old one
+                drop(e);
+                res = &e;
+            }
+        }
+        if (res == nullptr) for (entry& e : m_entries) {
+            if (not e.used) {
+                res = &e;
+                break;
+            }
+            if (res == nullptr or e.start < res->start) res = &e;
+        }
+        if (res->used) drop(*res);
+        res->used = true;
+        res->device = device;
+        res->seq = seq;
+        res->count = count;
+        res->mask = 0;
+        res->size = 0;
+        res->start = now;
+        return res;
+    }
+
+    //! @brief The maximum time a reassembly can take.
+    times_t m_timeout;
+    //! @brief The messages under reassembly.
+    entry m_entries[slots];
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_FRAGMENTATION_H_
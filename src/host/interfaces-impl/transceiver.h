@@ -0,0 +1,148 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file transceiver.h
+ * @brief Host stand-in for the MIOSIX 802.15.4 transceiver and its hardware timer.
+ */
+
+#ifndef FCPP_MIOSIX_HOST_TRANSCEIVER_H_
+#define FCPP_MIOSIX_HOST_TRANSCEIVER_H_
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+
+//! @brief Namespace of the MIOSIX kernel.
+namespace miosix {
+
+/**
+ * @brief Hardware timer ticking in nanoseconds of the host steady clock.
+ *
+ * The timer can be made to drift from the host clock through `setClockDrift`,
+ * in order to exercise clock synchronisation.
+ */
+class HardwareTimer {
+  public:
+    //! @brief Current timer value in ticks.
+    long long getValue() const;
+
+    //! @brief Waits until the given absolute time in ticks.
+    void absoluteWait(long long value);
+
+    //! @brief Tick frequency in Hz.
+    unsigned int getTickFrequency() const {
+        return 1000000000;
+    }
+
+    //! @brief Converts ticks to nanoseconds.
+    long long tick2ns(long long tick) const {
+        return tick;
+    }
+
+    //! @brief Converts nanoseconds to ticks.
+    long long ns2tick(long long ns) const {
+        return ns;
+    }
+};
+
+//! @brief The timer associated with the transceiver.
+HardwareTimer& getTransceiverTimer();
+
+//! @brief Makes the hardware timer drift with a relative skew and a constant offset in nanoseconds.
+void setClockDrift(double skew, long long offset);
+
+//! @brief Transceiver settings.
+class TransceiverConfiguration {
+  public:
+    TransceiverConfiguration(int frequency = 2450, int txPower = 0, bool crc = true, bool strictTimeout = false)
+        : frequency(frequency), txPower(txPower), crc(crc), strictTimeout(strictTimeout) {}
+
+    int frequency;
+    int txPower;
+    bool crc;
+    bool strictTimeout;
+};
+
+//! @brief Result of a receive call.
+class RecvResult {
+  public:
+    enum ErrorCode {
+        OK,
+        TIMEOUT,
+        TOO_LONG,
+        CRC_FAIL
+    };
+
+    long long timestamp = 0;
+    short rssi = -128;
+    int size = -1;
+    ErrorCode error = TIMEOUT;
+    bool timestampValid = false;
+};
+
+/**
+ * @brief Connects the transceiver to a broadcast medium shared by `nodes` processes on the local host.
+ *
+ * Frames are exchanged as UDP datagrams on the loopback interface, through ports from `port`
+ * to `port + nodes - 1` (`node` being the index of the calling process). Every frame is lost
+ * with probability `loss`, and is otherwise received with power `rssi`.
+ */
+void joinMedium(unsigned node, unsigned nodes, double loss = 0, short rssi = -50, unsigned short port = 47000);
+
+/**
+ * @brief Host transceiver: sent frames are recorded, received frames are injected.
+ *
+ * Frames sent are kept for inspection through `lastSent()` and broadcast to the medium
+ * (if joined), while `recv` pops frames previously queued through `inject` or coming
+ * from the medium, waiting up to the timeout otherwise.
+ */
+class Transceiver {
+  public:
+    //! @brief Time units for deadlines.
+    enum class Unit { TICK, NS };
+
+    //! @brief The transceiver instance.
+    static Transceiver& instance();
+
+    void configure(const TransceiverConfiguration& config) {
+        m_config = config;
+    }
+
+    void turnOn() {
+        m_on = true;
+    }
+
+    void turnOff() {
+        m_on = false;
+    }
+
+    //! @brief Sends a frame, after checking that the channel is clear.
+    bool sendCca(const void* pkt, int size);
+
+    //! @brief Receives a frame until the given absolute deadline.
+    RecvResult recv(void* pkt, int size, long long timeout, Unit unit = Unit::TICK);
+
+    //! @brief Queues a frame to be received, with a given signal strength.
+    void inject(const void* pkt, int size, short rssi);
+
+    //! @brief The last frame sent.
+    std::vector<char> lastSent() const;
+
+  private:
+    //! @brief A frame with its signal strength.
+    struct frame {
+        std::vector<char> data;
+        short rssi;
+    };
+
+    TransceiverConfiguration m_config;
+    bool m_on = false;
+    mutable std::mutex m_mutex;
+    std::deque<frame> m_inbox;
+    std::vector<char> m_sent;
+};
+
+}
+
+#endif // FCPP_MIOSIX_HOST_TRANSCEIVER_H_
@@ -0,0 +1,264 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <malloc.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "miosix.h"
+#include "interfaces-impl/transceiver.h"
+
+namespace miosix {
+
+long long getTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t uniqueId = getpid();
+
+uint64_t getUniqueId() {
+    return uniqueId;
+}
+
+void setUniqueId(uint64_t id) {
+    uniqueId = id;
+}
+
+static thread_local Thread* currentThread = nullptr;
+
+Thread* Thread::create(void (*startfunc)(void*), unsigned int, Priority, void* argv, unsigned short options) {
+    Thread* t = new Thread();
+    t->m_thread = std::thread([t,startfunc,argv](){
+        currentThread = t;
+        startfunc(argv);
+    });
+    if ((options & JOINABLE) == 0) t->m_thread.detach();
+    return t;
+}
+
+Thread* Thread::getCurrentThread() {
+    if (currentThread == nullptr) {
+        static thread_local Thread self;
+        currentThread = &self;
+    }
+    return currentThread;
+}
+
+void Thread::sleep(unsigned int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void Thread::wait() {
+    Thread* t = getCurrentThread();
+    std::unique_lock<std::mutex> lock(t->m_mutex);
+    t->m_cv.wait(lock, [t](){ return t->m_woken; });
+    t->m_woken = false;
+}
+
+TimedWaitResult Thread::IRQenableIrqAndTimedWait(FastInterruptDisableLock&, long long absoluteTimeNs) {
+    Thread* t = getCurrentThread();
+    std::unique_lock<std::mutex> lock(t->m_mutex);
+    std::chrono::steady_clock::time_point deadline{std::chrono::nanoseconds(absoluteTimeNs)};
+    bool woken = t->m_cv.wait_until(lock, deadline, [t](){ return t->m_woken; });
+    t->m_woken = false;
+    return woken ? TimedWaitResult::NoTimeout : TimedWaitResult::Timeout;
+}
+
+void Thread::wakeup() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_woken = true;
+    m_cv.notify_one();
+}
+
+bool Thread::join(void** result) {
+    if (not m_thread.joinable()) return false;
+    m_thread.join();
+    if (result) *result = nullptr;
+    delete this;
+    return true;
+}
+
+static std::atomic<bool> buttonPressed{false};
+
+void pressButton(bool pressed) {
+    buttonPressed = pressed;
+}
+
+int userButton::value() {
+    return buttonPressed ? 0 : 1;
+}
+
+unsigned int MemoryProfiling::getStackSize() {
+    return 0;
+}
+
+unsigned int MemoryProfiling::getAbsoluteFreeStack() {
+    return 0;
+}
+
+unsigned int MemoryProfiling::getCurrentFreeStack() {
+    return 0;
+}
+
+//! @brief Notional heap size of the host.
+static const unsigned int heapSize = 1u << 30;
+
+//! @brief Maximum heap ever used.
+static unsigned int heapPeak = 0;
+
+unsigned int MemoryProfiling::getHeapSize() {
+    return heapSize;
+}
+
+unsigned int MemoryProfiling::getCurrentFreeHeap() {
+#if defined(__GLIBC__) and (__GLIBC__ > 2 or __GLIBC_MINOR__ >= 33)
+    unsigned int used = mallinfo2().uordblks;
+#else
+    unsigned int used = mallinfo().uordblks;
+#endif
+    heapPeak = std::max(heapPeak, used);
+    return heapSize - used;
+}
+
+unsigned int MemoryProfiling::getAbsoluteFreeHeap() {
+    getCurrentFreeHeap();
+    return heapSize - heapPeak;
+}
+
+static double clockSkew = 0;
+
+static long long clockOffset = 0;
+
+void setClockDrift(double skew, long long offset) {
+    clockSkew = skew;
+    clockOffset = offset;
+}
+
+long long HardwareTimer::getValue() const {
+    long long t = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return clockOffset + t + (long long)(t * clockSkew);
+}
+
+void HardwareTimer::absoluteWait(long long value) {
+    long long now = getValue();
+    if (value > now) std::this_thread::sleep_for(std::chrono::nanoseconds((long long)((value - now) / (1 + clockSkew))));
+}
+
+HardwareTimer& getTransceiverTimer() {
+    static HardwareTimer timer;
+    return timer;
+}
+
+//! @brief The socket connected to the medium (negative if not joined).
+static int mediumSocket = -1;
+
+//! @brief Index of the process in the medium.
+static unsigned mediumNode = 0;
+
+//! @brief Number of processes sharing the medium.
+static unsigned mediumNodes = 0;
+
+//! @brief Probability of losing a frame.
+static double mediumLoss = 0;
+
+//! @brief Power of received frames.
+static short mediumRssi = -50;
+
+//! @brief First port of the medium.
+static unsigned short mediumPort = 0;
+
+void joinMedium(unsigned node, unsigned nodes, double loss, short rssi, unsigned short port) {
+    mediumSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port + node);
+    if (mediumSocket < 0 or bind(mediumSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror("joinMedium");
+        mediumSocket = -1;
+        return;
+    }
+    mediumNode = node;
+    mediumNodes = nodes;
+    mediumLoss = loss;
+    mediumRssi = rssi;
+    mediumPort = port;
+}
+
+Transceiver& Transceiver::instance() {
+    static Transceiver transceiver;
+    return transceiver;
+}
+
+bool Transceiver::sendCca(const void* pkt, int size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const char* p = static_cast<const char*>(pkt);
+    m_sent.assign(p, p + size);
+    if (not m_on) return false;
+    for (unsigned i = 0; mediumSocket >= 0 and i < mediumNodes; ++i) {
+        if (i == mediumNode) continue;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(mediumPort + i);
+        sendto(mediumSocket, p, size, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    return true;
+}
+
+RecvResult Transceiver::recv(void* pkt, int size, long long timeout, Unit) {
+    static std::default_random_engine rng(getUniqueId());
+    HardwareTimer& timer = getTransceiverTimer();
+    RecvResult result;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            char buf[256];
+            ssize_t n;
+            while (mediumSocket >= 0 and (n = ::recv(mediumSocket, buf, sizeof(buf), MSG_DONTWAIT)) >= 0)
+                if (m_on and std::uniform_real_distribution<double>()(rng) >= mediumLoss)
+                    m_inbox.push_back({std::vector<char>(buf, buf + n), mediumRssi});
+            if (m_on and not m_inbox.empty()) {
+                frame f = std::move(m_inbox.front());
+                m_inbox.pop_front();
+                result.timestamp = timer.getValue();
+                result.timestampValid = true;
+                result.rssi = f.rssi;
+                result.size = f.data.size();
+                if (result.size > size) {
+                    result.error = RecvResult::TOO_LONG;
+                    return result;
+                }
+                memcpy(pkt, f.data.data(), f.data.size());
+                result.error = RecvResult::OK;
+                return result;
+            }
+        }
+        long long now = timer.getValue();
+        if (now >= timeout) break;
+        timer.absoluteWait(std::min(timeout, now + 1000000LL));
+    }
+    result.error = RecvResult::TIMEOUT;
+    return result;
+}
+
+void Transceiver::inject(const void* pkt, int size, short rssi) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const char* p = static_cast<const char*>(pkt);
+    m_inbox.push_back({std::vector<char>(p, p + size), rssi});
+}
+
+std::vector<char> Transceiver::lastSent() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sent;
+}
+
+}
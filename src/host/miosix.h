@@ -0,0 +1,169 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file miosix.h
+ * @brief Host stand-in for the subset of the MIOSIX kernel used by the deployment code.
+ *
+ * Selected by adding `src/host` to the include path and defining `FCPP_MIOSIX_HOST`.
+ */
+
+#ifndef FCPP_MIOSIX_HOST_MIOSIX_H_
+#define FCPP_MIOSIX_HOST_MIOSIX_H_
+
+#include <cstdint>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+//! @brief Namespace of the MIOSIX kernel.
+namespace miosix {
+
+//! @brief Time in nanoseconds of the kernel clock (the host steady clock).
+long long getTime();
+
+//! @brief Unique hardware identifier of the (simulated) microcontroller.
+uint64_t getUniqueId();
+
+//! @brief Sets the unique hardware identifier of the (simulated) microcontroller.
+void setUniqueId(uint64_t id);
+
+//! @brief GPIO modes.
+struct Mode {
+    enum Mode_ {
+        INPUT,
+        OUTPUT
+    };
+};
+
+//! @brief A LED, whose state is kept in memory.
+template <int N>
+class Led {
+  public:
+    static void mode(Mode::Mode_) {}
+
+    static void high() {
+        state() = true;
+    }
+
+    static void low() {
+        state() = false;
+    }
+
+    static int value() {
+        return state();
+    }
+
+  private:
+    static std::atomic<bool>& state() {
+        static std::atomic<bool> s{false};
+        return s;
+    }
+};
+
+//! @brief The red LED.
+typedef Led<0> redLed;
+
+//! @brief The green LED.
+typedef Led<1> greenLed;
+
+//! @brief The user button, pressed through `pressButton`.
+class userButton {
+  public:
+    static void mode(Mode::Mode_) {}
+
+    //! @brief Zero if the button is pressed, one otherwise.
+    static int value();
+};
+
+//! @brief Presses or releases the user button (safe to call from signal handlers).
+void pressButton(bool pressed);
+
+//! @brief Memory usage statistics (heap usage is measured by the host allocator, stack usage is not measured).
+class MemoryProfiling {
+  public:
+    static unsigned int getStackSize();
+    static unsigned int getAbsoluteFreeStack();
+    static unsigned int getCurrentFreeStack();
+    static unsigned int getHeapSize();
+    static unsigned int getAbsoluteFreeHeap();
+    static unsigned int getCurrentFreeHeap();
+};
+
+/**
+ * @brief Disables interrupts while in scope.
+ *
+ * The host cannot disable interrupts: wakeups are latched by the waiting thread instead,
+ * so that a check followed by a wait misses none.
+ */
+class FastInterruptDisableLock {
+  public:
+    FastInterruptDisableLock() = default;
+    FastInterruptDisableLock(FastInterruptDisableLock const&) = delete;
+    FastInterruptDisableLock& operator=(FastInterruptDisableLock const&) = delete;
+};
+
+//! @brief Outcome of a timed wait.
+enum class TimedWaitResult {
+    NoTimeout,  //!< woken up before the timeout
+    Timeout     //!< the timeout expired
+};
+
+//! @brief Thread priority.
+typedef short Priority;
+
+//! @brief Minimum stack size of a thread.
+const unsigned int STACK_MIN = 256;
+
+//! @brief Highest thread priority (exclusive).
+const short PRIORITY_MAX = 4;
+
+//! @brief Priority of the main thread.
+const unsigned char MAIN_PRIORITY = 1;
+
+//! @brief A thread, backed by `std::thread` (stack size and priority are ignored).
+class Thread {
+  public:
+    //! @brief Thread creation options.
+    enum Options {
+        DEFAULT = 0,    //!< the thread is detached
+        JOINABLE = 1    //!< the thread has to be joined
+    };
+
+    //! @brief Creates and starts a thread running `startfunc(argv)`.
+    static Thread* create(void (*startfunc)(void*), unsigned int stacksize, Priority priority = 1, void* argv = nullptr, unsigned short options = DEFAULT);
+
+    //! @brief The calling thread (an object is made on first use for threads not created through `create`).
+    static Thread* getCurrentThread();
+
+    //! @brief Suspends the calling thread for some milliseconds.
+    static void sleep(unsigned int ms);
+
+    //! @brief Suspends the calling thread until `wakeup()` is called on it.
+    static void wait();
+
+    //! @brief Enables interrupts and suspends the calling thread until `wakeup()` is called on it or an absolute time in nanoseconds.
+    static TimedWaitResult IRQenableIrqAndTimedWait(FastInterruptDisableLock& dLock, long long absoluteTimeNs);
+
+    //! @brief Resumes the thread if waiting.
+    void wakeup();
+
+    //! @brief Waits for a joinable thread to terminate, and deletes it.
+    bool join(void** result = nullptr);
+
+  private:
+    //! @brief The underlying thread.
+    std::thread m_thread;
+    //! @brief Mutex guarding `m_woken`.
+    std::mutex m_mutex;
+    //! @brief Condition variable for `wait`.
+    std::condition_variable m_cv;
+    //! @brief Whether `wakeup` has been called since the last `wait`.
+    bool m_woken = false;
+};
+
+}
+
+#endif // FCPP_MIOSIX_HOST_MIOSIX_H_
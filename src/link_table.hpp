@@ -0,0 +1,174 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file link_table.hpp
+ * @brief Estimates of the quality of the links from neighbours, from the frames received.
+ */
+
+#ifndef FCPP_MIOSIX_LINK_TABLE_H_
+#define FCPP_MIOSIX_LINK_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <limits>
+#include <mutex>
+
+#include "lib/settings.hpp"
+#include "rssi_model.hpp"
+
+//! @brief Maximum number of neighbours whose links are estimated (defaults to twice the maximum degree).
+#ifndef FCPP_MIOSIX_LINK_SLOTS
+#ifdef DEGREE
+#define FCPP_MIOSIX_LINK_SLOTS (2*DEGREE)
+#else
+#define FCPP_MIOSIX_LINK_SLOTS 16
+#endif
+#endif
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+//! @brief Quality of the link from a neighbour.
+struct link_quality {
+    //! @brief Estimated packet reception rate (between 0 and 1).
+    real_t prr;
+    //! @brief Smoothed received power in dBm.
+    real_t rssi;
+    //! @brief Expected number of transmissions for a successful exchange (infinite if unknown).
+    real_t etx;
+    //! @brief Estimated distance in meters (infinite if unknown).
+    real_t distance;
+    //! @brief Probability that the link is above the power threshold.
+    real_t confidence;
+};
+
+
+/**
+ * @brief Fixed-size table of the links from the last `N` neighbours heard.
+ *
+ * Frames carry a sequence number incremented by the sender at each transmission, so that
+ * a gap in the sequence numbers received from a neighbour counts the frames lost. Reception
+ * rate and power are exponentially weighted moving averages with weight `alpha` for the
+ * last frame. The expected transmission count assumes symmetric links, while distance and
+ * confidence follow from the smoothed power through `rssi_calibration()`. When the table is
+ * full, the neighbour heard least recently is evicted. All the members are thread-safe.
+ */
+template <size_t N>
+class link_estimator {
+  public:
+    //! @brief Sequence gaps above this value are considered sender restarts rather than losses.
+    static constexpr uint8_t max_gap = 64;
+
+    //! @brief Constructor given the weight of the last frame and the time after which a silent link is lost.
+    link_estimator(real_t alpha = 0.1, times_t timeout = 10) : m_alpha(alpha), m_timeout(timeout) {}
+
+    //! @brief Records a frame with a given sequence number, received from a device at some time.
+    void update(device_t device, uint8_t seq, real_t rssi, times_t time) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t i = find(device);
+        entry* e = i < N ? m_entries + i : evict();
+        if (i == N) {
+            e->device = device;
+            e->used = true;
+            e->prr = 1;
+            e->rssi = rssi;
+        } else {
+            uint8_t gap = seq - e->seq;
+            if (gap == 0) return;
+            if (gap > max_gap) gap = 1;
+            real_t keep = 1;
+            for (uint8_t j = 0; j < gap; ++j) keep *= 1 - m_alpha;
+            e->prr = e->prr * keep + m_alpha;
+            e->rssi += m_alpha * (rssi - e->rssi);
+        }
+        e->seq = seq;
+        e->time = time;
+    }
+
+    //! @brief The quality of the link from a device at a given time (zero reception rate if unknown or lost).
+    link_quality operator()(device_t device, times_t now) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t i = find(device);
+        if (i == N or now - m_entries[i].time > m_timeout) {
+            real_t inf = std::numeric_limits<real_t>::infinity();
+            return {0, 0, inf, inf, 0};
+        }
+        entry const& e = m_entries[i];
+        rssi_model const& m = rssi_calibration();
+        return {e.prr, e.rssi, 1 / (e.prr * e.prr), m.distance(e.rssi, device), m.confidence(e.rssi)};
+    }
+
+    //! @brief Number of neighbours in the table.
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t n = 0;
+        for (size_t i = 0; i < N; ++i) n += m_entries[i].used;
+        return n;
+    }
+
+  private:
+    //! @brief The estimates for a neighbour.
+    struct entry {
+        //! @brief Whether the entry is in use.
+        bool used = false;
+        //! @brief The last sequence number received.
+        uint8_t seq = 0;
+        //! @brief The neighbour.
+        device_t device = 0;
+        //! @brief Time of the last frame received.
+        times_t time = 0;
+        //! @brief Estimated packet reception rate.
+        real_t prr = 0;
+        //! @brief Smoothed received power.
+        real_t rssi = 0;
+    };
+
+    //! @brief The index of the entry of a device (`N` if absent).
+    size_t find(device_t device) const {
+        for (size_t i = 0; i < N; ++i)
+            if (m_entries[i].used and m_entries[i].device == device) return i;
+        return N;
+    }
+
+    //! @brief A free entry, or the entry heard least recently.
+    entry* evict() {
+        entry* e = m_entries;
+        for (size_t i = 0; i < N; ++i) {
+            if (not m_entries[i].used) return m_entries + i;
+            if (m_entries[i].time < e->time) e = m_entries + i;
+        }
+        return e;
+    }
+
+    //! @brief Mutex guarding the entries.
+    mutable std::mutex m_mutex;
+    //! @brief Weight of the last frame in the averages.
+    real_t const m_alpha;
+    //! @brief Time after which a silent link is lost.
+    times_t const m_timeout;
+    //! @brief The entries.
+    entry m_entries[N];
+};
+
+//! @brief The estimates of the links from neighbours of the device.
+inline link_estimator<FCPP_MIOSIX_LINK_SLOTS>& link_table() {
+    static link_estimator<FCPP_MIOSIX_LINK_SLOTS> t;
+    return t;
+}
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_LINK_TABLE_H_
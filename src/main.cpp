@@ -1,10 +1,23 @@
 // Copyright © 2022 Giorgio Audrito. All Rights Reserved.
 
 #include <iostream>
+#include <string>
+
+#ifdef FCPP_MIOSIX_HOST
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include "miosix.h"
 #include "main.hpp"
 #include "driver.hpp"
+#include "row_dump.hpp"
 
 /**
  * @brief Namespace containing all the objects in the FCPP library.
@@ -22,7 +35,11 @@ inline uint16_t usedStack() {
 //! @brief The maximum heap used by the node (divided by 2 to fit in a short)
 inline uint16_t usedHeap() {
     using namespace miosix;
-    return (MemoryProfiling::getHeapSize() - MemoryProfiling::getAbsoluteFreeHeap() - BUFFER_SIZE*1024) / 2;
+#if FLASH_BLOCKS > 0
+    return (MemoryProfiling::getHeapSize() - MemoryProfiling::getAbsoluteFreeHeap() - option::flash_rows_type::buffer_size) / 2;
+#else
+    return (MemoryProfiling::getHeapSize() - MemoryProfiling::getAbsoluteFreeHeap() - option::rows_type::buffer_size) / 2;
+#endif
 }
 
 //! @brief Whether the button is currently pressed.
@@ -31,6 +48,49 @@ inline bool buttonPressed(device_t, uint16_t) {
     return userButton::value() == 0;
 }
 
+//! @brief Notifies the driver of the global clock value corresponding to a local time.
+inline void syncClock(times_t local, times_t global) {
+    os::global_clock().update(local, global);
+}
+
+//! @brief The global clock value corresponding to a local time, as estimated by the driver.
+inline times_t globalClock(times_t local) {
+    return os::global_clock().global(local);
+}
+
+//! @brief The quality of the link from a neighbour at a given time, as estimated by the driver.
+inline os::link_quality linkQuality(device_t uid, times_t t) {
+    return os::link_table()(uid, t);
+}
+
+//! @brief A counter of CPU cycles (of nanoseconds on the host).
+inline uint32_t cycleCount() {
+#ifdef FCPP_MIOSIX_HOST
+    return uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+//! @brief To be called at startup to make the cycle counter available
+inline void configureCycleCounter()
+{
+#ifndef FCPP_MIOSIX_HOST
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+//! @brief The file holding the persistent log of rows.
+inline std::string flashLogPath() {
+#ifdef FCPP_MIOSIX_HOST
+    return "node" + std::to_string(miosix::getUniqueId() - 1) + ".log";
+#else
+    return "/sd/rows.log";
+#endif
+}
+
 //! @brief To be called at startup to make the red LED available
 inline void configureRedLed()
 {
@@ -52,6 +112,27 @@ namespace coordination {
 //! @brief Handle for simulation code (empty).
 FUN void simulation_handle(ARGS) {}
 
+/**
+ * @brief Upper bounds on the size of the exports of the main program.
+ *
+ * The numbers of calls on a same type are a manual estimate, counted on `main.hpp` and on the
+ * library functions it calls, which has to be revised whenever they change (export lists only
+ * hold distinct types, so they cannot be derived at compile time). The calls counted are: up to
+ * 6 in the election, collection and broadcast of vulnerability detection; `old` and `nbr` on the
+ * contact and positive maps (when positives are not a digest); `counter` and `shared_clock` in
+ * time tracking; the three `gossip_max` of resource tracking.
+ *
+ * The bound is checked against the size of whole messages rather than of frames, since the driver
+ * splits messages larger than a frame into up to `FCPP_MIOSIX_MAX_FRAGMENTS` fragments, and
+ * reassembles them on reception: a message only fails to be sent if it exceeds `maxMessageSize`.
+ */
+FCPP_EXPORT_REPORT(main_exports, DEGREE,
+    export_calls<vulnerability_detection_t, 6>, export_calls<contact_tracing_t, 2>, export_calls<time_tracking_t, 2>,
+    export_calls<resource_tracking_t, 3>, topology_recording_t, link_tracking_t, termination_check_t, round_adaptation_t
+);
+
+static_assert(main_exports::value <= os::transceiver::maxMessageSize, "messages of the main program may exceed the maximum size of messages sent by the driver");
+
 }
 
 //! @brief Namespace for component options.
@@ -62,10 +143,17 @@ using namespace component::tags;
 //! @brief Import tags used by aggregate functions.
 using namespace coordination::tags;
 
+//! @brief The type of the logger object.
+#if FLASH_BLOCKS > 0
+using log_type = flash_rows_type;
+#else
+using log_type = rows_type;
+#endif
+
 //! @brief Main FCPP option setup.
 DECLARE_OPTIONS(deployment,
     main,
-    plot_type<rows_type>
+    plot_type<log_type>
 );
 
 }
@@ -73,26 +161,104 @@ DECLARE_OPTIONS(deployment,
 }
 
 
-//! @brief Main function starting FCPP.
-int main() {
+//! @brief Runs the node until termination, then prints its log.
+void runNode() {
     using namespace fcpp;
 
     configureRedLed();
+    configureCycleCounter();
     // Type for the network object.
     using net_t = component::deployment<option::deployment>::net;
+    // Report the bounds on message sizes.
+    std::cout << "export bounds (frame payload " << os::transceiver::maxPayloadSize << ")" << std::endl;
+    coordination::main_exports::print(std::cout);
     // Create the logger object.
-    option::rows_type row_store;
+#if FLASH_BLOCKS > 0
+    os::file_block_device flash(flashLogPath().c_str(), FLASH_BLOCK_SIZE*1024, FLASH_BLOCKS);
+    option::log_type row_store(flash, FLASH_ENDURANCE);
+#else
+    option::log_type row_store;
+#endif
     // The initialisation values.
     auto init_v = common::make_tagged_tuple<option::hoodsize, option::plotter>(device_t{DEGREE}, &row_store);
-    // Construct the network object.
-    net_t network{init_v};
-    // Run the program until exit.
-    network.run();
+    {
+        // Construct the network object.
+        net_t network{init_v};
+        // Run the program until exit.
+        network.run();
+        // Destroying the network stops the radio thread, so that the radio trace is dumped while idle.
+    }
+    os::driver_log().flushMirror();
+#if FLASH_BLOCKS > 0
+    row_store.flush();
+#endif
     // Print the log until button release.
     while (true) {
+        os::fragment_stats const& fs = os::fragment_counters();
         std::cout << "----" << std::endl << "log size " << row_store.byte_size() << std::endl;
+        std::cout << "fragments sent " << fs.sent << " received " << fs.received << " lost " << fs.lost << " reassembled " << fs.reassembled << std::endl;
+        os::delta_stats const& ds = os::delta_counters();
+        std::cout << "keyframes " << ds.keyframes << " deltas " << ds.deltas << " bytes " << ds.original_bytes << " encoded " << ds.encoded_bytes << " unresolved " << ds.unresolved << std::endl;
+        os::quiescence_stats const& qs = os::quiescence_counters();
+        std::cout << "skipped " << qs.skipped << " heartbeats " << qs.heartbeats << " replayed " << qs.replayed << " unmatched " << qs.unmatched << std::endl;
+#if FLASH_BLOCKS > 0
+        os::flash_log_stats const& ls = os::flash_log_counters();
+        std::cout << "flash blocks recovered " << ls.recovered << " written " << ls.written << " worn " << ls.worn << " errors " << ls.errors << " corrupted " << ls.corrupted << std::endl;
+#endif
+        if (os::driver_log().lost() > 0) std::cout << "driver log lost " << os::driver_log().lost() << " bytes" << std::endl;
+        os::radio_trace().dump(std::cout);
+#if BINARY_DUMP
+        os::dump_rows(std::cout, row_store);
+#else
         row_store.print(std::cout);
+#endif
+#ifdef FCPP_MIOSIX_HOST
+        break;
+#endif
         while (not buttonPressed(0,0));
     }
+}
+
+#ifdef FCPP_MIOSIX_HOST
+//! @brief Presses the button on interrupt, so that nodes terminate.
+extern "C" void interruptHandler(int) {
+    miosix::pressButton(true);
+}
+
+/**
+ * @brief Main function spawning a process per node: `main [nodes [seconds [loss]]]`.
+ *
+ * Nodes share a broadcast medium losing frames with the given probability, with drifting clocks.
+ * Their buttons are pressed after the given seconds (or on interrupt), and they terminate
+ * `PRESS_TIME` seconds later, writing their output to `node<i>.txt`.
+ */
+int main(int argc, char** argv) {
+    int nodes = argc > 1 ? atoi(argv[1]) : 4;
+    double seconds = argc > 2 ? atof(argv[2]) : 30;
+    double loss = argc > 3 ? atof(argv[3]) : 0;
+    signal(SIGINT, interruptHandler);
+    for (int i = 0; i < nodes; ++i) {
+        if (fork() != 0) continue;
+        std::string name = "node" + std::to_string(i) + ".txt";
+        if (freopen(name.c_str(), "w", stdout) == nullptr) return 1;
+        std::default_random_engine rng(i);
+        miosix::setUniqueId(i + 1);
+        miosix::setClockDrift(std::uniform_real_distribution<double>(-5e-5, 5e-5)(rng), std::uniform_int_distribution<long long>(0, 1000000000LL)(rng));
+        miosix::joinMedium(i, nodes, loss);
+        std::thread([seconds](){
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+            miosix::pressButton(true);
+        }).detach();
+        runNode();
+        return 0;
+    }
+    while (wait(nullptr) > 0);
+    return 0;
+}
+#else
+//! @brief Main function starting FCPP.
+int main() {
+    runNode();
     return 0;
 }
+#endif
@@ -4,19 +4,96 @@
 #define FCPP_EXPORT_NUM 2
 
 #include "lib/fcpp.hpp"
+#include "bitpack.hpp"
+#include "digest.hpp"
+#include "export_size.hpp"
+#include "flat_map.hpp"
+#include "link_table.hpp"
+#include "profiling.hpp"
+#include "flash_log.hpp"
 
 #define DEGREE       10  // maximum degree allowed for a deployment
 #define DIAMETER     10  // maximum diameter in hops for a deployment
 #define WINDOW_TIME  60  // time in seconds during which positive node information is retained
 #define PRESS_TIME   5   // time in seconds of button press after which termination is triggered
-#define ROUND_PERIOD 1   // time in seconds between transmission rounds
+#define ROUND_PERIOD 1   // time in seconds between transmission rounds (when the network is changing)
+#define MAX_ROUND_PERIOD 4  // time in seconds between transmission rounds when the network is stable
 #define BUFFER_SIZE  40  // size in KB to be used for buffering the output
+#define TRACKED_SIZE 20  // maximum number of devices tracked in contact, positive and uptime lists
+#define UPTIME_TIME  300 // time in seconds over which the uptime of links is averaged
+#define RETAIN_TIME  5   // time in seconds after which messages from neighbours are thrown away
+
+#define CONTACT_DIGEST  0     // whether positive nodes are gossiped as a fixed-size digest instead of a map
+#define DIGEST_EPOCHS   4     // number of epochs in which the time window is split by the digest
+#define DIGEST_CAPACITY 8     // expected number of positive nodes per epoch in the digest
+#define DIGEST_FP_RATE  0.05  // false positive rate of the digest when holding its expected number of nodes
+
+#define HEARTBEAT_PERIOD 0    // unchanged rounds between heartbeats replacing messages (0 to always send them)
+#define REFRESH_PERIOD   8    // unchanged rounds after which messages are sent again anyway
+
+#define FLASH_BLOCKS     0    // number of blocks of the persistent log of rows (0 to keep rows in RAM only)
+#define FLASH_BLOCK_SIZE 4    // size in KB of the blocks of the persistent log of rows
+#define FLASH_ENDURANCE  0    // erases after which a block of the persistent log is not used anymore (0 for no limit)
+#define BINARY_DUMP      0    // whether the log is dumped as binary frames (to be decoded by rowdump) instead of text
+
+#define PROFILE_CYCLES   0    // whether the cycles taken by the functions of a round are measured and logged
 
 /**
  * @brief Namespace containing all the objects in the FCPP library.
  */
 namespace fcpp {
 
+//! @brief Bounded map from devices to times, evicting the oldest entry when full.
+using time_map = flat_map<device_t, times_t, TRACKED_SIZE>;
+
+//! @brief Fixed-size digest of recent positive devices.
+using positive_digest = epoch_bloom<DIGEST_EPOCHS, bloom_bits(DIGEST_CAPACITY, DIGEST_FP_RATE), bloom_hashes(bloom_bits(DIGEST_CAPACITY, DIGEST_FP_RATE), DIGEST_CAPACITY)>;
+
+//! @brief Representation of positive devices gossiped by contact tracing.
+#if CONTACT_DIGEST
+using positive_t = positive_digest;
+#else
+using positive_t = time_map;
+#endif
+
+//! @brief Uptime of the link from a neighbour, ordered by the last time it was heard (so that the oldest is evicted first).
+struct link_uptime {
+    //! @brief Exponentially decaying fraction of rounds in which the neighbour was heard.
+    real_t uptime;
+    //! @brief The last time the neighbour was heard.
+    times_t last;
+
+    //! @brief Orders links by the last time they were heard.
+    bool operator<(link_uptime const& o) const {
+        return last < o.last;
+    }
+
+    //! @brief Equality operator.
+    bool operator==(link_uptime const& o) const {
+        return uptime == o.uptime and last == o.last;
+    }
+};
+
+//! @brief Printing a link uptime.
+inline std::ostream& operator<<(std::ostream& o, link_uptime const& l) {
+    return o << l.uptime;
+}
+
+//! @brief Bounded map from devices to link uptimes, evicting the link heard least recently when full.
+using uptime_map = flat_map<device_t, link_uptime, TRACKED_SIZE>;
+
+/**
+ * @brief Cycle statistics of the functions of a round (empty if not profiling).
+ *
+ * In order: time tracking, vulnerability detection, contact tracing, resource tracking,
+ * topology recording and the rest of the round.
+ */
+using profile_t = round_profile<PROFILE_CYCLES ? 6 : 0>;
+
+//! @brief Lists of devices hold at most the neighbours of a device, and the device itself.
+template <size_t hood>
+struct capacity_bound<std::vector<device_t>, hood> : std::integral_constant<size_t, hood + 1> {};
+
 // PURE C++ FUNCTIONS
 
 //! @brief The maximum stack used by the node starting from the boot
@@ -31,22 +108,47 @@ inline bool buttonPressed(fcpp::device_t, uint16_t);
 //! @brief Turn on or off the red LED.
 inline void setRedLed(bool value);
 
+//! @brief Notifies the driver of the global clock value corresponding to a local time.
+inline void syncClock(times_t local, times_t global);
+
+//! @brief The global clock value corresponding to a local time, as estimated by the driver.
+inline times_t globalClock(times_t local);
+
+//! @brief The quality of the link from a neighbour at a given time, as estimated by the driver.
+inline os::link_quality linkQuality(device_t uid, times_t t);
+
+//! @brief A counter of CPU cycles (or of nanoseconds, where cycles are not available).
+inline uint32_t cycleCount();
+
 //! @brief Packing four booleans into a char.
-struct stat {
-    stat() = default;
-    stat(bool a, bool b, bool c, bool d) {
-        s = a*1 + b*2 + c*4 + d*8;
-    }
-    stat(stat const&) = default;
+using stat = bitpack<bits<bool, 1>, bits<bool, 1>, bits<bool, 1>, bits<bool, 1>>;
 
-    uint8_t s;
-};
-inline bool operator==(stat x, stat y) {
-    return x.s == y.s;
-}
-inline std::ostream& operator<<(std::ostream& o, stat x) {
-    o << int((x.s&1) > 0) << " " << int((x.s&2) > 0) << " " << int((x.s&4) > 0) << " " << int((x.s&8) > 0);
-    return o;
+/**
+ * @brief Packing the logged columns from hop distance to degree (twice a short for the heap).
+ *
+ * Hop distances above `DIAMETER` (as the ones of devices not reached by the election)
+ * saturate to the largest value of the field, as larger stack, heap and degree values.
+ */
+using log_status_t = bitpack<
+    bits<hops_t, bit_width(DIAMETER)>,
+    bits<bool, 1>, bits<bool, 1>, bits<bool, 1>, bits<bool, 1>,
+    bits<uint16_t, 16>,
+    bits<uint32_t, 17>,
+    bits<uint8_t, 8>,
+    bits<int8_t, bit_width(DEGREE) + 1>
+>;
+
+static_assert((1ULL << bit_width(DIAMETER)) - 1 >= DIAMETER and (1ULL << bit_width(DEGREE)) - 1 >= DEGREE, "logged hop distances and degrees up to the maximum must fit their fields");
+
+//! @brief Namespace for plotting and logging facilities.
+namespace plot {
+    //! @brief The packed columns are logged under the names of the separate columns they replaced.
+    template <>
+    struct column_names<log_status_t> {
+        static char const* get() {
+            return "hop_dist bool_status max_stack max_heap max_msg degree";
+        }
+    };
 }
 
 
@@ -57,6 +159,8 @@ namespace coordination {
 namespace tags {
     //! @brief Total round count since start.
     struct round_count {};
+    //! @brief Current time between rounds.
+    struct round_period {};
     //! @brief A shared global clock.
     struct global_clock {};
     //! @brief Minimum UID in the network.
@@ -65,6 +169,8 @@ namespace tags {
     struct hop_dist {};
     //! @brief The overall status (compressing im_weak/some_weak/infector/infected into a single char)
     struct bool_status {};
+    //! @brief The logged columns from hop_dist to degree, packed into bitfields.
+    struct log_status {};
     //! @brief Whether the current device has only one neighbour.
     struct im_weak {};
     //! @brief Whether some device in the network has only one neighbour.
@@ -77,10 +183,16 @@ namespace tags {
     struct max_msg {};
     //! @brief Percentage of transmission success for the strongest link.
     struct strongest_link {};
+    //! @brief Average percentage of frames received from neighbours.
+    struct mean_link {};
     //! @brief The degree of the node.
     struct degree {};
     //! @brief List of neighbours encountered at least 50% of the times.
     struct nbr_list {};
+    //! @brief Uptime of the links from the neighbours heard recently.
+    struct link_uptimes {};
+    //! @brief Cycle statistics of the functions of a round.
+    struct cycle_profile {};
     //! @brief Whether the device is the initiator of an infection.
     struct infector {};
     //! @brief Whether the device has been infected.
@@ -98,7 +210,13 @@ namespace tags {
 FUN void time_tracking(ARGS) { CODE
     using namespace tags;
     node.storage(round_count{}) = counter(CALL, uint16_t{1});
+#if HEARTBEAT_PERIOD > 0
+    // frame timestamps keep the clock in sync, so that exports can stay unchanged across rounds
+    node.storage(global_clock{}) = globalClock(node.current_time());
+#else
     node.storage(global_clock{}) = shared_clock(CALL);
+    syncClock(node.current_time(), node.storage(global_clock{}));
+#endif
 }
 FUN_EXPORT time_tracking_t = export_list<counter_t<uint16_t>, shared_clock_t>;
 
@@ -116,27 +234,66 @@ FUN void topology_recording(ARGS) { CODE
     node.storage(tags::nbr_list{}).clear();
     list_hood(CALL, node.storage(tags::nbr_list{}), nbr_uid(CALL), nothing);
 
-    using map_t = std::unordered_map<device_t,times_t>;
-    map_t nbr_counters = old(CALL, map_t{}, [&](map_t n){
-        fold_hood(CALL, [&](device_t i, times_t t, tags::nothing){
-            if (t > node.previous_time()) n[i] += 1;
-            return nothing;
-        }, node.message_time(), nothing);
-        return n;
-    });
-    times_t c = 0;
-    for (const auto& it : nbr_counters)
-        c = max(c, it.second);
-    c = c * 100 / node.storage(tags::round_count{});
-    node.storage(tags::strongest_link{}) = (int8_t)round(c);
+    // decay uptimes, so that a link weighs the rounds of the last UPTIME_TIME seconds
+    uptime_map& links = node.storage(tags::link_uptimes{});
+    real_t alpha = min(real_t(node.current_time() - node.previous_time()) / UPTIME_TIME, real_t(1));
+    for (auto& l : links)
+        l.second.uptime *= 1 - alpha;
+    fold_hood(CALL, [&](device_t i, times_t t, tags::nothing){
+        if (t > node.previous_time()) {
+            link_uptime& l = links[i];
+            l.uptime += alpha;
+            l.last = t;
+        }
+        return nothing;
+    }, node.message_time(), nothing);
+    real_t c = 0;
+    for (auto const& l : links)
+        c = max(c, l.second.uptime);
+    node.storage(tags::strongest_link{}) = (int8_t)round(c * 100);
 }
-FUN_EXPORT topology_recording_t = export_list<std::unordered_map<device_t,times_t>>;
+FUN_EXPORT topology_recording_t = export_list<>;
+
+//! @brief The packet reception rate of the links from neighbours (at no message cost).
+FUN field<real_t> link_reception(ARGS) { CODE
+    return map_hood([&](device_t i){
+        return linkQuality(i, node.current_time()).prr;
+    }, nbr_uid(CALL));
+}
+FUN_EXPORT link_reception_t = export_list<>;
+
+//! @brief Tracks the average quality of the links from neighbours.
+FUN void link_tracking(ARGS) { CODE
+    real_t prr = fold_hood(CALL, [](real_t x, real_t y){
+        return x + y;
+    }, link_reception(CALL), real_t(0));
+    node.storage(tags::mean_link{}) = (int8_t)round(prr * 100 / max(node.size() - 1, size_t{1}));
+}
+FUN_EXPORT link_tracking_t = export_list<link_reception_t>;
 
 //! @brief Checks whether to terminate the execution.
 FUN void termination_check(ARGS) { CODE
-    if (round_since(CALL, not buttonPressed(node.uid, node.storage(tags::global_clock{}))) >= PRESS_TIME) node.terminate();
+    if (time_since(CALL, not buttonPressed(node.uid, node.storage(tags::global_clock{}))) >= PRESS_TIME) node.terminate();
+}
+FUN_EXPORT termination_check_t = export_list<time_since_t>;
+
+//! @brief Adapts the round period, shortening it when the node changes and doubling it up to MAX_ROUND_PERIOD when stable.
+FUN void round_adaptation(ARGS) { CODE
+    using namespace tags;
+    auto state = make_tuple(node.storage(nbr_list{}), node.storage(min_uid{}), node.storage(bool_status{}), buttonPressed(node.uid, node.storage(round_count{})));
+    bool changed = not (old(CALL, state) == state);
+    times_t period = nbr(CALL, times_t(ROUND_PERIOD), [&](field<times_t> p){
+        times_t t = changed ? times_t(ROUND_PERIOD) : min(self(CALL, p) * 2, times_t(MAX_ROUND_PERIOD));
+        // stay within twice the period of neighbours, so that changes spread at a fast pace
+        return fold_hood(CALL, [](times_t x, times_t y){
+            return min(x * 2, y);
+        }, p, t);
+    });
+    node.storage(round_period{}) = period;
+    // the schedule only starts the first round, so that this is the only source of rounds
+    node.next_time(node.current_time() + period);
 }
-FUN_EXPORT termination_check_t = export_list<round_since_t>;
+FUN_EXPORT round_adaptation_t = export_list<tuple<std::vector<device_t>, device_t, stat, bool>, times_t>;
 
 
 // AGGREGATE CASE STUDIES
@@ -159,8 +316,7 @@ FUN void contact_tracing(ARGS, times_t window) { CODE
     using namespace tags;
     bool positive = node.storage(infector{}) = toggle_filter(CALL, buttonPressed(node.uid, node.storage(round_count{})));
     setRedLed(positive);
-    using contact_t = std::unordered_map<device_t, times_t>;
-    node.storage(contacts{}) = old(CALL, contact_t{}, [&](contact_t c){
+    node.storage(contacts{}) = old(CALL, time_map{}, [&](time_map c){
         // discard old contacts
         for (auto it = c.begin(); it != c.end();) {
           if (node.current_time() - it->second > window)
@@ -175,10 +331,28 @@ FUN void contact_tracing(ARGS, times_t window) { CODE
         }, nbr_uids, 0);
         return c;
     });
-    node.storage(positives{}) = nbr(CALL, contact_t{}, [&](field<contact_t> np){
-        contact_t p{};
+#if CONTACT_DIGEST
+    // gossip a digest of positives, expiring after the epochs in the window
+    // (epochs follow the shared global clock, so that all nodes agree on their boundaries)
+    uint16_t epoch = node.storage(global_clock{}) * DIGEST_EPOCHS / window;
+    node.storage(positives{}) = nbr(CALL, positive_t{}, [&](field<positive_t> np){
+        positive_t p{epoch};
+        if (positive) p.insert(node.uid);
+        fold_hood(CALL, [&](positive_t const& d, int){
+            p.merge(d);
+            return 0;
+        }, np, 0);
+        return p;
+    });
+    node.storage(infected{}) = positive;
+    for (auto c : node.storage(contacts{}))
+        if (node.storage(positives{}).count(c.first))
+            node.storage(infected{}) = true;
+#else
+    node.storage(positives{}) = nbr(CALL, positive_t{}, [&](field<positive_t> np){
+        positive_t p{};
         if (positive) p[node.uid] = node.current_time();
-        fold_hood(CALL, [&](contact_t const& cs, int){
+        fold_hood(CALL, [&](positive_t const& cs, int){
             for (auto c : cs)
                 if (node.current_time() - c.second < window)
                     p[c.first] = max(p[c.first], c.second);
@@ -190,8 +364,9 @@ FUN void contact_tracing(ARGS, times_t window) { CODE
     for (auto c : node.storage(positives{}))
         if (node.storage(contacts{}).count(c.first))
             node.storage(infected{}) = true;
+#endif
 }
-FUN_EXPORT contact_tracing_t = export_list<toggle_filter_t, std::unordered_map<device_t, times_t>>;
+FUN_EXPORT contact_tracing_t = export_list<toggle_filter_t, time_map, positive_t>;
 
 
 // AGGREGATE MAIN
@@ -201,20 +376,33 @@ FUN void simulation_handle(ARGS);
 
 //! @brief Main aggregate function.
 MAIN() {
+    cycle_profiler<profile_t::size> profile(node.storage(tags::cycle_profile{}), cycleCount);
     time_tracking(CALL);
+    profile.step(0);
     vulnerability_detection(CALL, DIAMETER);
+    profile.step(1);
     contact_tracing(CALL, WINDOW_TIME);
+    profile.step(2);
     resource_tracking(CALL);
+    profile.step(3);
     topology_recording(CALL);
+    profile.step(4);
+    link_tracking(CALL);
     termination_check(CALL);
     simulation_handle(CALL);
     using namespace tags;
     node.storage(bool_status{}) = stat(node.storage(im_weak{}), node.storage(some_weak{}), node.storage(infector{}), node.storage(infected{}));
+    node.storage(log_status{}) = log_status_t(
+        node.storage(hop_dist{}), node.storage(im_weak{}), node.storage(some_weak{}), node.storage(infector{}), node.storage(infected{}),
+        node.storage(max_stack{}), node.storage(max_heap{}), node.storage(max_msg{}), node.storage(degree{})
+    );
+    round_adaptation(CALL);
+    profile.step(5);
 }
 FUN_EXPORT main_t = export_list<
     vulnerability_detection_t,
     contact_tracing_t,
-    time_tracking_t, resource_tracking_t, topology_recording_t, termination_check_t
+    time_tracking_t, resource_tracking_t, topology_recording_t, link_tracking_t, termination_check_t, round_adaptation_t
 >;
 
 } // namespace coordination
@@ -228,15 +416,20 @@ using namespace component::tags;
 //! @brief Import tags used by aggregate functions.
 using namespace coordination::tags;
 
-//! @brief Dictates that messages are thrown away after 5/1 seconds.
-using retain_type = retain<metric::retain<5, 1>>;
+//! @brief Dictates that messages are thrown away after RETAIN_TIME seconds.
+using retain_type = retain<metric::retain<RETAIN_TIME, 1>>;
+
+// a stable node sends a message or heartbeat only once every HEARTBEAT_PERIOD rounds (if positive)
+static_assert(MAX_ROUND_PERIOD * (HEARTBEAT_PERIOD > 0 ? HEARTBEAT_PERIOD : 1) < RETAIN_TIME, "neighbours must send within the retain time, even when stable and quiescent");
+static_assert(MAX_ROUND_PERIOD < PRESS_TIME, "button presses must last at least a round, even when stable");
 
-//! @brief Dictates that rounds are happening every 1 seconds (den, start, period).
-using schedule_type = round_schedule<sequence::periodic_n<1, ROUND_PERIOD, ROUND_PERIOD>>;
+//! @brief Dictates that the first round starts after ROUND_PERIOD seconds (count, time), while the following ones are planned by `round_adaptation`.
+using schedule_type = round_schedule<sequence::multiple_n<1, ROUND_PERIOD>>;
 
 //! @brief Tag-type pairs that can appear in node.storage(tag{}) = type{} expressions (are all printed in output).
 using store_type = tuple_store<
     round_count,    uint16_t,
+    round_period,   times_t,
     global_clock,   times_t,
     min_uid,        device_t,
     hop_dist,       hops_t,
@@ -245,34 +438,41 @@ using store_type = tuple_store<
     infector,       bool,
     infected,       bool,
     bool_status,    stat,
-    contacts,       std::unordered_map<device_t, times_t>,
-    positives,      std::unordered_map<device_t, times_t>,
+    log_status,     log_status_t,
+    contacts,       time_map,
+    positives,      positive_t,
     max_stack,      uint16_t,
     max_heap,       uint32_t,
     max_msg,        uint8_t,
     strongest_link, int8_t,
+    mean_link,      int8_t,
     degree,         int8_t,
-    nbr_list,       std::vector<device_t>
+    nbr_list,       std::vector<device_t>,
+    link_uptimes,   uptime_map,
+    cycle_profile,  profile_t
 >;
 
-//! @brief Tag-type pairs to be stored for logging after execution end.
-using rows_type = plot::rows<
-    tuple_store<
-        min_uid,        device_t,
-        hop_dist,       hops_t,
-        bool_status,    stat,
-        max_stack,      uint16_t,
-        max_heap,       uint32_t,
-        max_msg,        uint8_t,
-        degree,         int8_t,
-        nbr_list,       std::vector<device_t>
-    >,
-    tuple_store<
-        global_clock,   times_t
-    >,
-    void,
-    BUFFER_SIZE*1024
+//! @brief Tag-type pairs to be logged in rows after the global clock.
+#if PROFILE_CYCLES
+using log_columns = tuple_store<
+    min_uid,        device_t,
+    log_status,     log_status_t,
+    nbr_list,       std::vector<device_t>,
+    cycle_profile,  profile_t
+>;
+#else
+using log_columns = tuple_store<
+    min_uid,        device_t,
+    log_status,     log_status_t,
+    nbr_list,       std::vector<device_t>
 >;
+#endif
+
+//! @brief Tag-type pairs to be stored for logging after execution end (compressing unchanged rows).
+using rows_type = plot::compressed_rows<global_clock, log_columns, BUFFER_SIZE*1024>;
+
+//! @brief Rows to be persisted on a flash-like device, surviving reboots.
+using flash_rows_type = plot::flash_rows<global_clock, log_columns, os::file_block_device, FLASH_BLOCK_SIZE*1024>;
 
 //! @brief Main FCPP option setup.
 DECLARE_OPTIONS(main,
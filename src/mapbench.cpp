@@ -0,0 +1,119 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/settings.hpp"
+#include "lib/common/serialize.hpp"
+
+#include "flat_map.hpp"
+
+
+//! @brief Bytes currently allocated on the heap.
+static size_t heap_used = 0;
+
+//! @brief Maximum bytes ever allocated on the heap.
+static size_t heap_peak = 0;
+
+//! @brief Bytes reserved before each allocation to record its size (keeping the alignment).
+constexpr size_t heap_header = alignof(std::max_align_t);
+
+void* operator new(size_t n) {
+    char* p = static_cast<char*>(std::malloc(n + heap_header));
+    if (p == nullptr) throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(p) = n;
+    heap_used += n;
+    if (heap_used > heap_peak) heap_peak = heap_used;
+    return p + heap_header;
+}
+
+void operator delete(void* q) noexcept {
+    if (q == nullptr) return;
+    char* p = static_cast<char*>(q) - heap_header;
+    heap_used -= *reinterpret_cast<size_t*>(p);
+    std::free(p);
+}
+
+void operator delete(void* q, size_t) noexcept {
+    operator delete(q);
+}
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+    //! @brief Number of rounds in which the map is updated.
+    constexpr size_t rounds = 100;
+
+    //! @brief Number of lookups of each key, for timing.
+    constexpr size_t lookups = 100000;
+
+    //! @brief Result of the lookups, so that they are not optimised away.
+    volatile double sink;
+
+    //! @brief Measures a map type holding `degree` neighbours, printing a row of results.
+    template <typename M>
+    void measure(std::string const& name, size_t degree) {
+        std::mt19937 rng(42);
+        std::vector<device_t> keys;
+        while (keys.size() < degree) {
+            device_t k = device_t(rng());
+            bool fresh = true;
+            for (device_t x : keys) fresh = fresh and x != k;
+            if (fresh) keys.push_back(k);
+        }
+        // heap high-water of updating the map every round and copying it (as exports do)
+        size_t base = heap_used;
+        heap_peak = heap_used;
+        M m;
+        for (size_t r = 0; r < rounds; ++r) {
+            for (device_t k : keys) m[k] = times_t(r);
+            M copy = m;
+            if (copy.size() != degree) std::cerr << name << ": lost entries" << std::endl;
+        }
+        size_t peak = heap_peak - base;
+        // lookup cost
+        times_t sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lookups; ++i)
+            for (device_t k : keys) sum += m.find(k)->second;
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (lookups * degree);
+        // serialised size
+        common::osstream os;
+        os << m;
+        std::cout << std::left << std::setw(14) << name << std::right << std::setw(7) << degree << std::setw(10) << sizeof(M) << std::setw(10) << peak << std::setw(10) << std::fixed << std::setprecision(1) << ns << std::setw(12) << os.data().size();
+        std::cout << std::endl;
+        sink = double(sum);
+    }
+
+    //! @brief Measures the flat map and the unordered map for a given degree.
+    template <size_t degree>
+    void measure_degree() {
+        measure<flat_map<device_t, times_t, degree>>("flat_map", degree);
+        measure<std::unordered_map<device_t, times_t>>("unordered_map", degree);
+    }
+}
+
+
+/**
+ * @brief Compares the flat map of contact tracing with `std::unordered_map`, for 10 and 50 neighbours.
+ *
+ * For each container, prints the size of the object, the heap high-water of updating every
+ * neighbour in a round and copying the map (as exports do), the average time of a lookup
+ * and the serialised size of the map.
+ */
+int main() {
+    std::cout << "# container    degree    object      heap lookup_ns  serialised" << std::endl;
+    fcpp::measure_degree<10>();
+    fcpp::measure_degree<50>();
+    return 0;
+}
@@ -0,0 +1,165 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file pool.hpp
+ * @brief Fixed-size pool of preallocated objects, recycled without heap allocations.
+ */
+
+#ifndef FCPP_MIOSIX_POOL_H_
+#define FCPP_MIOSIX_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+/**
+ * @brief Fixed-size pool of `N` objects of type `T`.
+ *
+ * Objects are handed out through move-only `pointer` handles, which give the
+ * object back to the pool on destruction. Acquiring and releasing is lock-free,
+ * so a producer thread can acquire slots while a consumer releases them. Free objects
+ * are tracked by a bitmask split into 32-bit atomic words.
+ */
+template <typename T, size_t N>
+class pool {
+    static_assert(N > 0, "pools must hold at least an object");
+
+  public:
+    //! @brief Owning handle to an object of the pool.
+    class pointer {
+      public:
+        //! @brief Empty handle.
+        pointer() = default;
+
+        //! @brief Move constructor.
+        pointer(pointer&& o) : m_pool(o.m_pool), m_index(o.m_index) {
+            o.m_pool = nullptr;
+        }
+
+        //! @brief Move assignment.
+        pointer& operator=(pointer&& o) {
+            if (this != &o) {
+                reset();
+                m_pool = o.m_pool;
+                m_index = o.m_index;
+                o.m_pool = nullptr;
+            }
+            return *this;
+        }
+
+        //! @brief Gives the object back to the pool.
+        ~pointer() {
+            reset();
+        }
+
+        //! @brief Whether the handle owns an object.
+        explicit operator bool() const {
+            return m_pool != nullptr;
+        }
+
+        //! @brief Access to the object.
+        T& operator*() const {
+            return m_pool->m_data[m_index];
+        }
+
+        //! @brief Access to the object members.
+        T* operator->() const {
+            return &m_pool->m_data[m_index];
+        }
+
+        //! @brief Index of the object within the pool.
+        size_t index() const {
+            return m_index;
+        }
+
+        //! @brief Gives the object back to the pool, leaving the handle empty.
+        void reset() {
+            if (m_pool) m_pool->release(m_index);
+            m_pool = nullptr;
+        }
+
+      private:
+        friend class pool;
+
+        //! @brief Handle to a given object.
+        pointer(pool* p, size_t i) : m_pool(p), m_index(i) {}
+
+        //! @brief The pool owning the object.
+        pool* m_pool = nullptr;
+        //! @brief The index of the object.
+        size_t m_index = 0;
+    };
+
+    //! @brief The number of objects in the pool.
+    static constexpr size_t capacity = N;
+
+    //! @brief Constructor.
+    pool() {
+        for (size_t w = 0; w < words; ++w)
+            m_free[w].store(N - 32*w >= 32 ? ~uint32_t{0} : (uint32_t{1} << (N - 32*w)) - 1, std::memory_order_relaxed);
+    }
+
+    pool(pool const&) = delete;
+    pool& operator=(pool const&) = delete;
+
+    //! @brief Takes a free object from the pool (empty handle if none is available).
+    pointer acquire() {
+        for (size_t w = 0; w < words; ++w) {
+            uint32_t f = m_free[w].load(std::memory_order_relaxed);
+            while (f != 0) {
+                uint32_t b = f & (~f + 1);
+                if (m_free[w].compare_exchange_weak(f, f & ~b, std::memory_order_acquire, std::memory_order_relaxed))
+                    return pointer(this, 32*w + lowest_bit(b));
+            }
+        }
+        return pointer();
+    }
+
+    //! @brief The number of objects currently available.
+    size_t available() const {
+        size_t c = 0;
+        for (size_t w = 0; w < words; ++w)
+            for (uint32_t f = m_free[w].load(std::memory_order_relaxed); f; f &= f - 1) ++c;
+        return c;
+    }
+
+  private:
+    //! @brief Number of words of the bitmask.
+    static constexpr size_t words = (N + 31) / 32;
+
+    //! @brief Index of the only bit set in a word.
+    static size_t lowest_bit(uint32_t b) {
+        size_t i = 0;
+        while (b >>= 1) ++i;
+        return i;
+    }
+
+    //! @brief Gives an object back to the pool.
+    void release(size_t i) {
+        m_free[i / 32].fetch_or(uint32_t{1} << (i % 32), std::memory_order_release);
+    }
+
+    //! @brief The objects.
+    T m_data[N];
+    //! @brief Bitmask of free objects.
+    std::atomic<uint32_t> m_free[words];
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_POOL_H_
@@ -0,0 +1,187 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file profiling.hpp
+ * @brief Statistics of the cycles taken by the functions called in each round.
+ */
+
+#ifndef FCPP_MIOSIX_PROFILING_H_
+#define FCPP_MIOSIX_PROFILING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ostream>
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Minimum, mean and maximum of the cycles taken by a function across rounds.
+struct cycle_stats {
+    //! @brief Adds a measurement.
+    void insert(uint32_t cycles) {
+        if (count == 0 or cycles < min) min = cycles;
+        if (cycles > max) max = cycles;
+        sum += cycles;
+        ++count;
+    }
+
+    //! @brief The mean of the measurements.
+    uint32_t mean() const {
+        return count == 0 ? 0 : uint32_t(sum / count);
+    }
+
+    //! @brief Equality operator.
+    bool operator==(cycle_stats const& o) const {
+        return min == o.min and max == o.max and sum == o.sum and count == o.count;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        return s & min & max & sum & count;
+    }
+
+    //! @brief Serialises the content to a given output stream.
+    template <typename S>
+    S& serialize(S& s) const {
+        return s << min << max << sum << count;
+    }
+
+    //! @brief The minimum measurement.
+    uint32_t min = 0;
+    //! @brief The maximum measurement.
+    uint32_t max = 0;
+    //! @brief The sum of the measurements.
+    uint64_t sum = 0;
+    //! @brief The number of measurements.
+    uint32_t count = 0;
+};
+
+//! @brief Printing cycle statistics as minimum, mean and maximum separated by spaces.
+inline std::ostream& operator<<(std::ostream& o, cycle_stats const& s) {
+    return o << s.min << " " << s.mean() << " " << s.max;
+}
+
+
+//! @brief Cycle statistics of `N` functions called in each round.
+template <size_t N>
+struct round_profile {
+    //! @brief Number of functions.
+    static constexpr size_t size = N;
+
+    //! @brief Access to the statistics of the i-th function.
+    cycle_stats& operator[](size_t i) {
+        return m_data[i];
+    }
+
+    //! @brief Const access to the statistics of the i-th function.
+    cycle_stats const& operator[](size_t i) const {
+        return m_data[i];
+    }
+
+    //! @brief Equality operator.
+    bool operator==(round_profile const& o) const {
+        for (size_t i = 0; i < N; ++i)
+            if (not (m_data[i] == o.m_data[i])) return false;
+        return true;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        for (size_t i = 0; i < N; ++i) m_data[i].serialize(s);
+        return s;
+    }
+
+    //! @brief Serialises the content to a given output stream.
+    template <typename S>
+    S& serialize(S& s) const {
+        for (size_t i = 0; i < N; ++i) m_data[i].serialize(s);
+        return s;
+    }
+
+  private:
+    //! @brief The statistics.
+    cycle_stats m_data[N];
+};
+
+//! @brief Empty cycle statistics, when profiling is disabled.
+template <>
+struct round_profile<0> {
+    //! @brief Number of functions.
+    static constexpr size_t size = 0;
+
+    //! @brief Equality operator.
+    bool operator==(round_profile const&) const {
+        return true;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) const {
+        return s;
+    }
+};
+
+//! @brief Printing cycle statistics of functions, separated by spaces.
+template <size_t N>
+std::ostream& operator<<(std::ostream& o, round_profile<N> const& p) {
+    for (size_t i = 0; i < N; ++i) o << (i ? " " : "") << p[i];
+    return o;
+}
+
+//! @brief Printing empty cycle statistics.
+inline std::ostream& operator<<(std::ostream& o, round_profile<0> const&) {
+    return o;
+}
+
+
+/**
+ * @brief Measures the cycles taken by consecutive steps of a round, through a cycle counter.
+ *
+ * Step `i` spans from the previous call to `step` (or the construction) to the call to
+ * `step(i)`, and its cycles are added to the i-th statistics of a profile. The profiler
+ * of an empty profile does nothing, so that disabled profiling costs nothing.
+ */
+template <size_t N>
+class cycle_profiler {
+  public:
+    //! @brief Constructor, given the profile and the cycle counter.
+    cycle_profiler(round_profile<N>& profile, uint32_t (*counter)()) : m_profile(profile), m_counter(counter), m_start(counter()) {}
+
+    //! @brief Ends the i-th step.
+    void step(size_t i) {
+        uint32_t t = m_counter();
+        m_profile[i].insert(t - m_start);
+        m_start = m_counter();
+    }
+
+  private:
+    //! @brief The profile.
+    round_profile<N>& m_profile;
+    //! @brief The cycle counter.
+    uint32_t (*m_counter)();
+    //! @brief Counter value at the start of the current step.
+    uint32_t m_start;
+};
+
+//! @brief Profiler doing nothing, when profiling is disabled.
+template <>
+class cycle_profiler<0> {
+  public:
+    //! @brief Constructor (ignoring its arguments).
+    cycle_profiler(round_profile<0>&, uint32_t (*)()) {}
+
+    //! @brief Ends a step (doing nothing).
+    void step(size_t) {}
+};
+
+
+}
+
+#endif // FCPP_MIOSIX_PROFILING_H_
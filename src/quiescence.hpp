@@ -0,0 +1,189 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file quiescence.hpp
+ * @brief Suppression of unchanged messages, replaced by heartbeats replaying the cached copy at receivers.
+ */
+
+#ifndef FCPP_MIOSIX_QUIESCENCE_H_
+#define FCPP_MIOSIX_QUIESCENCE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "lib/settings.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+//! @brief Counters of the message suppression activity (updated by the radio thread).
+struct quiescence_stats {
+    //! @brief Unchanged messages not sent at all.
+    std::atomic<uint32_t> skipped{0};
+    //! @brief Unchanged messages replaced by a heartbeat.
+    std::atomic<uint32_t> heartbeats{0};
+    //! @brief Heartbeats received whose message was replayed.
+    std::atomic<uint32_t> replayed{0};
+    //! @brief Heartbeats received whose message was missing.
+    std::atomic<uint32_t> unmatched{0};
+};
+
+//! @brief The message suppression counters since boot.
+inline quiescence_stats& quiescence_counters() {
+    static quiescence_stats s;
+    return s;
+}
+
+
+//! @brief What to do with an outgoing message.
+enum class quiet_action {
+    send,       //!< send the message
+    heartbeat,  //!< send a heartbeat in place of the unchanged message
+    skip        //!< do not send anything
+};
+
+
+/**
+ * @brief Decides whether outgoing messages of up to `max_size` bytes have to be sent.
+ *
+ * A message equal to the previous one is replaced by a heartbeat once every `period`
+ * messages and skipped otherwise, while it is sent again anyway once every `refresh`
+ * messages, so that neighbours having lost it eventually recover.
+ */
+template <size_t max_size>
+class quiet_filter {
+  public:
+    //! @brief Constructor given the heartbeat period (zero to disable suppression) and the refresh period.
+    quiet_filter(uint8_t period, uint8_t refresh) : m_period(period), m_refresh(refresh) {}
+
+    //! @brief What to do with a message.
+    quiet_action check(char const* msg, size_t size) {
+        if (m_period == 0 or size > max_size) return quiet_action::send;
+        if (m_valid and size == m_size and memcmp(msg, m_last, size) == 0) {
+            ++m_since;
+            if (m_refresh > 0 and m_since % m_refresh == 0) return quiet_action::send;
+            if (m_since % m_period == 0) {
+                quiescence_counters().heartbeats.fetch_add(1, std::memory_order_relaxed);
+                return quiet_action::heartbeat;
+            }
+            quiescence_counters().skipped.fetch_add(1, std::memory_order_relaxed);
+            return quiet_action::skip;
+        }
+        memcpy(m_last, msg, size);
+        m_size = size;
+        m_valid = true;
+        m_since = 0;
+        return quiet_action::send;
+    }
+
+    //! @brief Forgets the previous message (as it did not reach neighbours).
+    void reset() {
+        m_valid = false;
+    }
+
+  private:
+    //! @brief Number of messages between heartbeats.
+    uint8_t m_period;
+    //! @brief Number of messages after which an unchanged message is sent again.
+    uint8_t m_refresh;
+    //! @brief Whether a previous message is known.
+    bool m_valid = false;
+    //! @brief Number of messages equal to the previous one since it was last sent.
+    uint32_t m_since = 0;
+    //! @brief Size of the previous message.
+    size_t m_size = 0;
+    //! @brief The previous message.
+    char m_last[max_size];
+};
+
+
+/**
+ * @brief Caches the last message of up to `max_size` bytes received from up to `slots` neighbours.
+ *
+ * Messages are tagged with the sequence number of the frame carrying them, which heartbeats
+ * refer to: a heartbeat replays the cached message only if it is the one the sender means.
+ * The least recently used entry is evicted when room is needed for a new neighbour.
+ */
+template <size_t max_size, size_t slots>
+class message_cache {
+  public:
+    //! @brief Caches a message from a device, carried by a frame with a given sequence number.
+    void store(device_t device, uint8_t seq, char const* msg, size_t size) {
+        if (size > max_size) return;
+        entry& e = find(device);
+        e.seq = seq;
+        e.size = size;
+        e.last = ++m_clock;
+        memcpy(e.data, msg, size);
+    }
+
+    /**
+     * @brief Replays the message from a device carried by a frame with a given sequence number.
+     *
+     * @return Whether the message is cached: if so, `out` and `out_size` are set to its content,
+     *         which stays valid until the next call to `store`.
+     */
+    bool replay(device_t device, uint8_t seq, char const*& out, size_t& out_size) {
+        for (entry& e : m_entries)
+            if (e.size != npos and e.device == device and e.seq == seq) {
+                e.last = ++m_clock;
+                out = e.data;
+                out_size = e.size;
+                quiescence_counters().replayed.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        quiescence_counters().unmatched.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+  private:
+    //! @brief Marker of unused entries.
+    static constexpr size_t npos = size_t(-1);
+
+    //! @brief The last message received from a neighbour.
+    struct entry {
+        //! @brief The neighbour.
+        device_t device;
+        //! @brief The sequence number of the frame carrying the message.
+        uint8_t seq;
+        //! @brief The message size (npos if unused).
+        size_t size = npos;
+        //! @brief Last time the entry has been used.
+        uint32_t last;
+        //! @brief The message.
+        char data[max_size];
+    };
+
+    //! @brief The entry of a device, possibly replacing the least recently used one.
+    entry& find(device_t device) {
+        entry* res = &m_entries[0];
+        for (entry& x : m_entries) {
+            if (x.size != npos and x.device == device) return x;
+            if (res->size != npos and (x.size == npos or x.last < res->last)) res = &x;
+        }
+        res->device = device;
+        return *res;
+    }
+
+    //! @brief Counter used for recency of entries.
+    uint32_t m_clock = 0;
+    //! @brief The cached messages.
+    entry m_entries[slots];
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_QUIESCENCE_H_
@@ -0,0 +1,66 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file quiet_connector.hpp
+ * @brief Simulated connector suppressing the messages of quiescent devices.
+ */
+
+#ifndef FCPP_MIOSIX_QUIET_CONNECTOR_H_
+#define FCPP_MIOSIX_QUIET_CONNECTOR_H_
+
+#include <utility>
+
+#include "lib/settings.hpp"
+#include "lib/common/tagged_tuple.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing all the connection predicates.
+namespace connect {
+
+
+/**
+ * @brief Connection predicate dropping the messages of quiet devices, on top of a base connector.
+ *
+ * Simulates the suppression of unchanged messages by the driver: while a device is flagged
+ * as quiet through `node.connector_data().quiet`, its messages reach no neighbour, which keep
+ * using the last one received until it expires (as receivers replaying their cached copy on
+ * heartbeats). The base connection data is `node.connector_data().base`.
+ */
+template <class connector>
+class quiet : public connector {
+  public:
+    //! @brief Type for representing a position.
+    using position_type = typename connector::position_type;
+
+    //! @brief Type of connection data needed.
+    struct data_type {
+        //! @brief Connection data of the base connector.
+        typename connector::data_type base{};
+        //! @brief Whether the messages of the device are suppressed.
+        bool quiet = false;
+    };
+
+    //! @brief Generator and tagged tuple constructor.
+    template <typename G, typename S, typename T>
+    quiet(G&& g, common::tagged_tuple<S,T> const& t) : connector(std::forward<G>(g), t) {}
+
+    //! @brief Checks if connection is possible.
+    template <typename G>
+    bool operator()(G&& gen, data_type const& data1, position_type const& position1, data_type const& data2, position_type const& position2) const {
+        return not data1.quiet and connector::operator()(gen, data1.base, position1, data2.base, position2);
+    }
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_QUIET_CONNECTOR_H_
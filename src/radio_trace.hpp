@@ -0,0 +1,165 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file radio_trace.hpp
+ * @brief Binary tracing of radio events into a RAM ring buffer, dumped in bulk.
+ */
+
+#ifndef FCPP_MIOSIX_RADIO_TRACE_H_
+#define FCPP_MIOSIX_RADIO_TRACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+//! @brief Number of events retained by the radio trace.
+#ifndef FCPP_MIOSIX_TRACE_SIZE
+#define FCPP_MIOSIX_TRACE_SIZE 256
+#endif
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+//! @brief Events traced by the driver.
+enum class trace_event : uint8_t {
+    none,               //!< empty record
+    sent,               //!< a frame was sent
+    channel_busy,       //!< a frame was not sent since the channel was busy
+    send_error,         //!< a frame was not sent due to an exception
+    received,           //!< a frame was received
+    rejected,           //!< a frame was received with wrong header, short size or low RSSI
+    too_long,           //!< a frame was received exceeding the maximum size
+    crc_fail,           //!< a frame was received with wrong CRC
+    receive_error,      //!< a frame was not received due to an exception
+    pool_full,          //!< no slot was available to receive a frame
+    queue_full,         //!< a received frame was dropped since the receive queue was full
+    unknown_kind,       //!< a frame of unknown kind was dropped
+    size                //!< number of events
+};
+
+//! @brief Printable name of an event.
+inline char const* trace_event_name(trace_event e) {
+    static char const* names[] = {"none", "sent", "channel_busy", "send_error", "received", "rejected", "too_long", "crc_fail", "receive_error", "pool_full", "queue_full", "unknown_kind"};
+    return e < trace_event::size ? names[uint8_t(e)] : "invalid";
+}
+
+//! @brief A traced event, stored in 16 bytes (little-endian in dumps).
+struct trace_record {
+    //! @brief Time of the event in nanoseconds (local transceiver clock).
+    int64_t time;
+    //! @brief The other device involved (lower 32 bits).
+    uint32_t peer;
+    //! @brief Size of the frame.
+    uint16_t size;
+    //! @brief The event.
+    trace_event event;
+    //! @brief Received power in dBm.
+    int8_t rssi;
+};
+
+static_assert(sizeof(trace_record) == 16, "trace records must be 16 bytes long");
+
+
+/**
+ * @brief Ring buffer of the last `N` traced events.
+ *
+ * Recording an event reserves a record with a single atomic increment, so that it can
+ * be done from any thread in a few cycles. The buffer should be dumped while idle, as
+ * records written concurrently may be dumped partially.
+ *
+ * Dumps are textual, and can be safely mixed with other console output: a line `#trace <total> <count>`
+ * is followed by `count` lines `#T <hex>`, each encoding a record in 32 hexadecimal digits.
+ */
+template <size_t N>
+class trace_buffer {
+  public:
+    //! @brief Records an event.
+    void record(int64_t time, trace_event e, size_t size, int rssi = 0, uint64_t peer = 0) {
+        trace_record& r = m_data[m_total.fetch_add(1, std::memory_order_relaxed) % N];
+        r.time = time;
+        r.peer = uint32_t(peer);
+        r.size = uint16_t(size);
+        r.event = e;
+        r.rssi = int8_t(rssi);
+    }
+
+    //! @brief Number of events ever recorded.
+    uint32_t total() const {
+        return m_total.load(std::memory_order_relaxed);
+    }
+
+    //! @brief Number of events in the buffer.
+    size_t count() const {
+        return total() < N ? total() : N;
+    }
+
+    //! @brief The i-th oldest event in the buffer.
+    trace_record const& operator[](size_t i) const {
+        return m_data[(total() - count() + i) % N];
+    }
+
+    //! @brief Dumps the events in the buffer, from the oldest.
+    void dump(std::ostream& o) const {
+        static char const digits[] = "0123456789abcdef";
+        uint32_t t = total();
+        size_t n = t < N ? t : N;
+        o << "#trace " << t << " " << n << "\n";
+        for (size_t i = 0; i < n; ++i) {
+            unsigned char const* p = reinterpret_cast<unsigned char const*>(&m_data[(t - n + i) % N]);
+            char line[2*sizeof(trace_record)+1];
+            for (size_t j = 0; j < sizeof(trace_record); ++j) {
+                line[2*j] = digits[p[j] >> 4];
+                line[2*j+1] = digits[p[j] & 15];
+            }
+            line[2*sizeof(trace_record)] = 0;
+            o << "#T " << line << "\n";
+        }
+        o << std::flush;
+    }
+
+  private:
+    //! @brief Number of events ever recorded.
+    std::atomic<uint32_t> m_total{0};
+    //! @brief The records.
+    trace_record m_data[N] = {};
+};
+
+//! @brief Parses a record from a dumped line (without the `#T ` prefix), returning whether it succeeded.
+inline bool parse_trace_record(std::string const& line, trace_record& r) {
+    if (line.size() < 2*sizeof(trace_record)) return false;
+    unsigned char p[sizeof(trace_record)];
+    for (size_t j = 0; j < 2*sizeof(trace_record); ++j) {
+        char c = line[j];
+        int v = c >= '0' and c <= '9' ? c - '0' : c >= 'a' and c <= 'f' ? c - 'a' + 10 : -1;
+        if (v < 0) return false;
+        p[j/2] = j % 2 ? (p[j/2] | v) : (v << 4);
+    }
+    memcpy(&r, p, sizeof(trace_record));
+    return true;
+}
+
+//! @brief The radio trace of the device.
+inline trace_buffer<FCPP_MIOSIX_TRACE_SIZE>& radio_trace() {
+    static trace_buffer<FCPP_MIOSIX_TRACE_SIZE> t;
+    return t;
+}
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_RADIO_TRACE_H_
@@ -0,0 +1,230 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file recorded_connector.hpp
+ * @brief Simulated connector reproducing the link dynamics recorded in a real deployment.
+ */
+
+#ifndef FCPP_MIOSIX_RECORDED_CONNECTOR_H_
+#define FCPP_MIOSIX_RECORDED_CONNECTOR_H_
+
+#include <cmath>
+#include <cstdint>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lib/settings.hpp"
+#include "lib/common/tagged_tuple.hpp"
+
+//! @brief Directory of the recorded node logs.
+#ifndef FCPP_RECORDED_PATH
+#define FCPP_RECORDED_PATH "input/"
+#endif
+
+//! @brief Start of the replayed time window in the recorded logs, in seconds.
+#ifndef FCPP_RECORDED_START
+#define FCPP_RECORDED_START 420
+#endif
+
+//! @brief End of the replayed time window in the recorded logs, in seconds.
+#ifndef FCPP_RECORDED_STOP
+#define FCPP_RECORDED_STOP 1020
+#endif
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing connection predicates.
+namespace connect {
+
+
+//! @brief A node of the recorded deployment.
+struct recorded_node {
+    //! @brief The number of the box, naming the log file.
+    int box;
+    //! @brief The FCPP identifier, appearing in neighbour lists.
+    device_t uid;
+};
+
+//! @brief The nodes of the recorded deployment, in the order of their paper names (see `input/mapping.txt`).
+constexpr recorded_node recorded_nodes[] = {
+    {3, 33060}, {0, 33115}, {5, 65449}, {9, 65499}, {10, 65496}, {11, 65448}, {12, 65498}, {13, 65497}
+};
+
+//! @brief Number of nodes of the recorded deployment.
+constexpr size_t recorded_size = sizeof(recorded_nodes) / sizeof(recorded_node);
+
+
+/**
+ * @brief Link dynamics recorded in the neighbour lists logged by the nodes of a deployment.
+ *
+ * For every second in the time window and every receiver, holds the set of senders heard,
+ * together with the transition probabilities of a two-state Markov chain fitted on every link.
+ */
+class recorded_links {
+  public:
+    //! @brief Loads the recorded logs.
+    recorded_links() {
+        size_t steps = FCPP_RECORDED_STOP - FCPP_RECORDED_START;
+        for (size_t r = 0; r < recorded_size; ++r) {
+            m_heard[r].assign(steps, 0);
+            std::ifstream in(FCPP_RECORDED_PATH "node" + std::to_string(recorded_nodes[r].box) + ".txt");
+            m_loaded = m_loaded and in.is_open();
+            std::string line;
+            uint32_t last = 0;
+            size_t next = 0;
+            while (std::getline(in, line)) {
+                size_t open = line.find('['), close = line.find(']');
+                if (line.empty() or line[0] == '#' or open == std::string::npos or close == std::string::npos) continue;
+                long t = long(std::floor(std::stod(line))) - FCPP_RECORDED_START;
+                for (; next < steps and long(next) < t; ++next) m_heard[r][next] = last;
+                std::stringstream ss(line.substr(open + 1, close - open - 1));
+                last = 0;
+                std::string id;
+                while (ss >> id)
+                    for (size_t s = 0; s < recorded_size; ++s)
+                        if (std::stoul(id) == recorded_nodes[s].uid) last |= uint32_t(1) << s;
+            }
+            for (; next < steps; ++next) m_heard[r][next] = last;
+        }
+        fit();
+    }
+
+    //! @brief Number of recorded seconds (zero if some log is missing).
+    size_t steps() const {
+        return m_loaded ? m_heard[0].size() : 0;
+    }
+
+    //! @brief Whether receiver `r` heard sender `s` at a given second.
+    bool heard(size_t s, size_t r, size_t step) const {
+        return (m_heard[r][step % m_heard[r].size()] >> s) & 1;
+    }
+
+    //! @brief Fraction of time in which receiver `r` heard sender `s`.
+    real_t uptime(size_t s, size_t r) const {
+        return m_uptime[s][r];
+    }
+
+    //! @brief Probability that a link is up after a second, given its current state.
+    real_t transition(size_t s, size_t r, bool up) const {
+        return m_transition[s][r][up];
+    }
+
+    //! @brief The recorded links (loaded once).
+    static recorded_links const& instance() {
+        static recorded_links l;
+        return l;
+    }
+
+  private:
+    //! @brief Fits the uptime and transition probabilities of every link.
+    void fit() {
+        for (size_t s = 0; s < recorded_size; ++s)
+            for (size_t r = 0; r < recorded_size; ++r) {
+                size_t up = 0, count[2] = {0, 0}, next_up[2] = {0, 0};
+                size_t n = m_heard[r].size();
+                for (size_t t = 0; t < n; ++t) {
+                    bool h = heard(s, r, t);
+                    up += h;
+                    if (t + 1 == n) continue;
+                    ++count[h];
+                    next_up[h] += heard(s, r, t + 1);
+                }
+                m_uptime[s][r] = n ? real_t(up) / n : 0;
+                for (int h = 0; h < 2; ++h)
+                    m_transition[s][r][h] = count[h] ? real_t(next_up[h]) / count[h] : m_uptime[s][r];
+            }
+    }
+
+    //! @brief Whether all the logs have been loaded.
+    bool m_loaded = true;
+    //! @brief For every receiver and second, the set of senders heard.
+    std::vector<uint32_t> m_heard[recorded_size];
+    //! @brief Fraction of time in which every link is up.
+    real_t m_uptime[recorded_size][recorded_size];
+    //! @brief Probability of every link being up after a second, given its current state.
+    real_t m_transition[recorded_size][recorded_size][2];
+};
+
+
+/**
+ * @brief Connection predicate restricting a base connector to the links recorded in a deployment.
+ *
+ * Simulated devices are mapped to recorded nodes by UID modulo the number of recorded nodes:
+ * a connection from the first to the second device (as allowed by the base connector)
+ * is up if the corresponding recorded link was up at the same second (modulo the recorded
+ * time window), or if the two devices map to the same recorded node. If `markov` is true,
+ * links follow instead a two-state Markov chain fitted on the recorded ones, with the
+ * same uptime and burstiness. The UID and time of devices have to be set every round
+ * through `node.connector_data()`.
+ */
+template <class connector, bool markov = false>
+class recorded : public connector {
+  public:
+    //! @brief Type for representing a position.
+    using position_type = typename connector::position_type;
+
+    //! @brief Type of connection data needed.
+    struct data_type {
+        //! @brief Connection data of the base connector.
+        typename connector::data_type base{};
+        //! @brief UID of the device.
+        device_t uid = 0;
+        //! @brief Current time of the device.
+        times_t time = 0;
+    };
+
+    //! @brief Generator and tagged tuple constructor.
+    template <typename G, typename S, typename T>
+    recorded(G&& g, common::tagged_tuple<S,T> const& t) : connector(std::forward<G>(g), t), m_links(recorded_links::instance()) {}
+
+    //! @brief Copy constructor.
+    recorded(recorded const& c) : connector(c), m_links(c.m_links), m_state(c.m_state) {}
+
+    //! @brief Checks if connection is possible.
+    template <typename G>
+    bool operator()(G&& gen, data_type const& data1, position_type const& position1, data_type const& data2, position_type const& position2) const {
+        if (not connector::operator()(gen, data1.base, position1, data2.base, position2)) return false;
+        size_t s = data1.uid % recorded_size, r = data2.uid % recorded_size;
+        if (s == r or m_links.steps() == 0) return true;
+        size_t step = size_t(std::max(data2.time, times_t(0)));
+        if (not markov) return m_links.heard(s, r, step);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_state.find({data1.uid, data2.uid});
+        if (it == m_state.end()) {
+            bool up = std::bernoulli_distribution(m_links.uptime(s, r))(gen);
+            it = m_state.emplace(std::make_pair(data1.uid, data2.uid), std::make_pair(step, up)).first;
+        }
+        for (; it->second.first < step; ++it->second.first)
+            it->second.second = std::bernoulli_distribution(m_links.transition(s, r, it->second.second))(gen);
+        return it->second.second;
+    }
+
+  private:
+    //! @brief The recorded links.
+    recorded_links const& m_links;
+    //! @brief Mutex guarding the link states.
+    mutable std::mutex m_mutex;
+    //! @brief The last second and state of every simulated link (for Markov links).
+    mutable std::map<std::pair<device_t, device_t>, std::pair<size_t, bool>> m_state;
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_RECORDED_CONNECTOR_H_
@@ -0,0 +1,125 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "streamlogger.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+    //! @brief Length of the records written.
+    constexpr size_t record_size = 16;
+
+    //! @brief Number of records written by each thread.
+    constexpr unsigned records = 100000;
+
+    //! @brief Writes a record of a thread.
+    inline void write_record(LogStreambuf& log, int thread, unsigned seq) {
+        char buf[record_size + 1];
+        snprintf(buf, sizeof(buf), "%02d %012u\n", thread, seq);
+        log.write(buf, record_size);
+    }
+
+    //! @brief Result of writing records from several threads.
+    struct run_result {
+        //! @brief What was mirrored to the console.
+        std::string mirrored;
+        //! @brief Seconds taken by the writers.
+        double seconds;
+    };
+
+    //! @brief Writes records from several threads, while another thread mirrors them.
+    inline run_result run(LogStreambuf& log, int threads) {
+        std::stringstream console;
+        std::streambuf* cout_buf = std::cout.rdbuf(console.rdbuf());
+        std::atomic<bool> writing{true};
+        std::thread mirror([&](){
+            while (writing) {
+                log.flushMirror();
+                std::this_thread::yield();
+            }
+        });
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> writers;
+        for (int t = 0; t < threads; ++t)
+            writers.emplace_back([&log,t](){
+                for (unsigned i = 0; i < records; ++i) write_record(log, t, i);
+            });
+        for (auto& w : writers) w.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        writing = false;
+        mirror.join();
+        log.flushMirror();
+        std::cout.rdbuf(cout_buf);
+        return {console.str(), seconds};
+    }
+
+    //! @brief Whether a text is made of the records of the threads, each exactly once and in order.
+    inline bool all_records(std::string const& text, int threads) {
+        if (text.size() != record_size * records * threads) return false;
+        std::vector<unsigned> next(threads, 0);
+        for (size_t p = 0; p < text.size(); p += record_size) {
+            std::string record = text.substr(p, record_size);
+            int t;
+            unsigned seq;
+            if (sscanf(record.c_str(), "%d %u", &t, &seq) != 2 or t < 0 or t >= threads or seq != next[t]++ or record.back() != '\n') return false;
+        }
+        return true;
+    }
+}
+
+
+/**
+ * @brief Stresses the ring mode of `LogStreambuf`, with writers in concurrent threads.
+ *
+ * Records are written from 1, 2 and 4 threads while another thread mirrors them. In a ring
+ * large enough for all of them, every record has to be mirrored exactly once, as written.
+ * In a small ring, the bytes mirrored and the bytes lost have to add up to the bytes written.
+ * Also prints the throughput and the average time of a write call. Returns non-zero on failure.
+ */
+int main() {
+    using namespace fcpp;
+
+    int failures = 0;
+    auto check = [&](bool ok, std::string const& what) {
+        if (not ok) {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    };
+
+    std::cout << "# threads    MB/s  ns/write" << std::endl;
+    for (int threads : {1, 2, 4}) {
+        LogStreambuf large(record_size * records * threads, LogStreambuf::Mode::Ring);
+        run_result r = run(large, threads);
+        check(large.lost() == 0 and all_records(r.mirrored, threads), std::to_string(threads) + " threads mirrored from a large ring");
+        double bytes = double(record_size) * records * threads;
+        printf("%9d %7.1f %9.1f\n", threads, bytes / r.seconds / 1e6, r.seconds * 1e9 / records);
+
+        LogStreambuf small(4096, LogStreambuf::Mode::Ring);
+        r = run(small, threads);
+        check(r.mirrored.size() + small.lost() == bytes and small.size() == 4096, std::to_string(threads) + " threads mirrored from a small ring");
+    }
+
+    {
+        // the last bytes are kept, and dumped
+        LogStreambuf ring(64, LogStreambuf::Mode::Ring);
+        for (unsigned i = 0; i < 20; ++i) write_record(ring, 0, i);
+        std::stringstream console;
+        std::streambuf* cout_buf = std::cout.rdbuf(console.rdbuf());
+        ring.dump();
+        std::cout.rdbuf(cout_buf);
+        check(console.str() == "00 000000000016\n00 000000000017\n00 000000000018\n00 000000000019\n\n", "last bytes dumped");
+    }
+    if (failures == 0) std::cout << "all checks passed" << std::endl;
+    return failures;
+}
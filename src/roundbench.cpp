@@ -0,0 +1,71 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "lib/settings.hpp"
+
+#include "clock_sync.hpp"
+#include "link_table.hpp"
+#include "tdma.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+    //! @brief Number of rounds measured.
+    constexpr int rounds = 20000;
+
+    //! @brief Number of neighbours heard every round.
+    constexpr device_t neighbours = 10;
+
+    //! @brief Result of the rounds, so that they are not optimised away.
+    volatile double sink;
+}
+
+
+/**
+ * @brief Measures the time and link estimation code run every round, with `times_t` and `real_t` as configured.
+ *
+ * Every round, frames from 10 neighbours update the link table, the clock synchronisation and the
+ * TDMA schedule, which are then queried together with the decay of 20 uptime estimates.
+ * Prints the average time of a round and a checksum of the results, which should agree in the
+ * `double` and fixed-point configurations (`-DFIXED_POINT=ON`) up to the rounding of fixed-point numbers.
+ */
+int main() {
+    using namespace fcpp;
+
+    os::link_estimator<2*neighbours> links;
+    os::clock_sync clock;
+    clock.uid(neighbours + 1);
+    os::tdma_schedule tdma(neighbours + 1, times_t(1), 8, 4);
+    real_t uptime[2*neighbours] = {};
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> rssi(-90, -40);
+    double checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        times_t now = times_t(r) + times_t(0.013 * (r % 7));
+        // receptions, carrying the round of the root as sequence number
+        for (device_t d = 1; d <= neighbours; ++d) {
+            links.update(d, uint8_t(r), real_t(rssi(rng)), now);
+            clock.sample(now, now + times_t(0.0001 * d), 1, uint16_t(r + 1));
+            tdma.heard(d, now);
+        }
+        // round computations
+        times_t until;
+        checksum += tdma.listening(now, until) + tdma.transmitting(now);
+        real_t alpha = real_t(times_t(1)) / 300;
+        real_t prr = 0;
+        for (device_t d = 1; d <= neighbours; ++d) prr += links(d, now).prr;
+        for (real_t& u : uptime) u = u * (1 - alpha) + alpha;
+        checksum += double(prr) + double(clock.global(now)) + double(uptime[3]);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+    sink = checksum;
+    std::cout << std::fixed << std::setprecision(2) << us << " us per round, checksum " << std::setprecision(3) << checksum << std::endl;
+    return 0;
+}
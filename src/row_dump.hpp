@@ -0,0 +1,242 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file row_dump.hpp
+ * @brief Dump of encoded rows as console lines of CRC-protected binary frames.
+ */
+
+#ifndef FCPP_MIOSIX_ROW_DUMP_H_
+#define FCPP_MIOSIX_ROW_DUMP_H_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "crc.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+//! @brief Maximum number of bytes of encoded rows carried by a dump frame.
+constexpr size_t dump_payload_size = 45;
+
+//! @brief Bytes of a dump frame besides its payload (sequence number, flags and CRC).
+constexpr size_t dump_overhead_size = 7;
+
+//! @brief A frame of a row dump.
+struct dump_frame {
+    //! @brief Sequence number of the frame in the dump.
+    uint16_t seq;
+    //! @brief Whether the frame starts a block (which is decoded independently).
+    bool first;
+    //! @brief The encoded rows carried.
+    std::vector<char> payload;
+};
+
+
+//! @cond INTERNAL
+namespace details {
+    //! @brief Digits of the base64 encoding.
+    constexpr char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    //! @brief Value of a base64 digit (-1 if not a digit).
+    inline int base64_value(char c) {
+        return c >= 'A' and c <= 'Z' ? c - 'A' : c >= 'a' and c <= 'z' ? c - 'a' + 26 : c >= '0' and c <= '9' ? c - '0' + 52 : c == '+' ? 62 : c == '/' ? 63 : -1;
+    }
+
+    //! @brief Writes a frame as a line `#R <base64>`.
+    inline void dump_frame_line(std::ostream& o, uint16_t seq, bool first, char const* data, size_t size) {
+        uint8_t frame[dump_payload_size + dump_overhead_size];
+        size_t n = 0;
+        frame[n++] = uint8_t(seq);
+        frame[n++] = uint8_t(seq >> 8);
+        frame[n++] = first;
+        for (size_t i = 0; i < size; ++i) frame[n++] = uint8_t(data[i]);
+        uint32_t crc = crc32(frame, n);
+        for (size_t j = 0; j < 4; ++j) frame[n++] = uint8_t(crc >> (8*j));
+        char line[(dump_payload_size + dump_overhead_size + 2) / 3 * 4 + 1];
+        size_t l = 0;
+        for (size_t i = 0; i < n; i += 3) {
+            uint32_t v = uint32_t(frame[i]) << 16 | (i+1 < n ? uint32_t(frame[i+1]) << 8 : 0) | (i+2 < n ? frame[i+2] : 0);
+            line[l++] = base64_digits[v >> 18];
+            line[l++] = base64_digits[(v >> 12) & 63];
+            line[l++] = i+1 < n ? base64_digits[(v >> 6) & 63] : '=';
+            line[l++] = i+2 < n ? base64_digits[v & 63] : '=';
+        }
+        line[l] = 0;
+        o << "#R " << line << "\n";
+    }
+}
+//! @endcond
+
+
+/**
+ * @brief Dumps the rows of a store, as blocks of encoded rows split into frames.
+ *
+ * The store has to provide `for_each_block(f)`, calling `f(data, size)` on every block
+ * of encoded rows, and `dropped()`. Dumps are textual, and can be safely mixed with other
+ * console output: a line `#rows <blocks> <bytes> <dropped>` is followed by lines `#R <base64>`,
+ * each encoding a frame of up to `dump_payload_size` bytes of a block, and by a line `#end <frames>`.
+ */
+template <typename S>
+void dump_rows(std::ostream& o, S const& store) {
+    size_t blocks = 0, bytes = 0;
+    store.for_each_block([&](char const*, size_t size){
+        ++blocks;
+        bytes += size;
+    });
+    o << "#rows " << blocks << " " << bytes << " " << store.dropped() << "\n";
+    uint16_t seq = 0;
+    store.for_each_block([&](char const* data, size_t size){
+        size_t p = 0;
+        do {
+            size_t n = size - p < dump_payload_size ? size - p : dump_payload_size;
+            details::dump_frame_line(o, seq++, p == 0, data + p, n);
+            p += n;
+        } while (p < size);
+    });
+    o << "#end " << seq << std::endl;
+}
+
+//! @brief Parses a frame from a dumped line (without the `#R ` prefix), returning whether it succeeded and its CRC matched.
+inline bool parse_dump_frame(std::string const& line, dump_frame& f) {
+    std::vector<uint8_t> frame;
+    uint32_t v = 0;
+    size_t bits = 0;
+    for (char c : line) {
+        if (c == '=' or c == '\r') break;
+        int x = details::base64_value(c);
+        if (x < 0) return false;
+        v = (v << 6) | uint32_t(x);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            frame.push_back(uint8_t(v >> bits));
+        }
+    }
+    if (frame.size() < dump_overhead_size or frame.size() > dump_payload_size + dump_overhead_size) return false;
+    size_t n = frame.size() - 4;
+    uint32_t crc = 0;
+    for (size_t j = 0; j < 4; ++j) crc |= uint32_t(frame[n+j]) << (8*j);
+    if (crc != crc32(frame.data(), n)) return false;
+    f.seq = frame[0] | uint16_t(frame[1] << 8);
+    f.first = frame[2] != 0;
+    f.payload.assign(frame.begin() + 3, frame.begin() + n);
+    return true;
+}
+
+
+/**
+ * @brief Collects the blocks of encoded rows from the console lines of a dump.
+ *
+ * Lines are read one at a time, so that dumps can be found within other console output.
+ * Frames failing their CRC are skipped, together with the rest of their block (whose rows
+ * cannot be decoded past a missing frame), and a corrupted frame count is ignored.
+ */
+class dump_reader {
+  public:
+    //! @brief Reads a console line, returning whether it belongs to a dump.
+    bool read(std::string const& line) {
+        m_ended = false;
+        if (line.compare(0, 6, "#rows ") == 0) {
+            std::stringstream ss(line.substr(6));
+            size_t count, bytes;
+            m_dropped = 0;
+            ss >> count >> bytes >> m_dropped;
+            m_dumping = true;
+            m_valid = false;
+            m_received = m_frames = m_seq = 0;
+            m_blocks.clear();
+            return true;
+        }
+        if (not m_dumping) return false;
+        if (line.compare(0, 3, "#R ") == 0) {
+            dump_frame f;
+            if (not parse_dump_frame(line.substr(3), f)) return true;
+            ++m_received;
+            if (f.first) {
+                m_blocks.emplace_back();
+                m_valid = true;
+            } else if (f.seq != m_seq) m_valid = false;
+            m_seq = f.seq + 1;
+            if (m_valid) m_blocks.back().insert(m_blocks.back().end(), f.payload.begin(), f.payload.end());
+            return true;
+        }
+        if (line.compare(0, 5, "#end ") == 0) {
+            char const* s = line.c_str() + 5;
+            char* end;
+            errno = 0;
+            unsigned long frames = std::strtoul(s, &end, 10);
+            if (*s >= '0' and *s <= '9' and (*end == 0 or *end == '\r') and errno == 0) m_frames = frames;
+            m_dumping = false;
+            m_ended = true;
+            return true;
+        }
+        return false;
+    }
+
+    //! @brief Whether the last line read ended a dump.
+    bool ended() const {
+        return m_ended;
+    }
+
+    //! @brief Whether a dump was started and not yet ended.
+    bool dumping() const {
+        return m_dumping;
+    }
+
+    //! @brief The blocks of encoded rows received in the last dump.
+    std::vector<std::vector<char>> const& blocks() const {
+        return m_blocks;
+    }
+
+    //! @brief Number of rows dropped by the store dumped.
+    size_t dropped() const {
+        return m_dropped;
+    }
+
+    //! @brief Number of frames of the last dump not received (or corrupted).
+    size_t lost() const {
+        return m_received < m_frames ? m_frames - m_received : 0;
+    }
+
+  private:
+    //! @brief Whether a dump is being read.
+    bool m_dumping = false;
+    //! @brief Whether the last line read ended a dump.
+    bool m_ended = false;
+    //! @brief Whether the current block has received all its frames so far.
+    bool m_valid = false;
+    //! @brief Number of valid frames received.
+    size_t m_received = 0;
+    //! @brief Number of frames dumped, according to the end line.
+    size_t m_frames = 0;
+    //! @brief Number of rows dropped by the store dumped.
+    size_t m_dropped = 0;
+    //! @brief The sequence number expected for the next frame.
+    uint16_t m_seq = 0;
+    //! @brief The blocks of encoded rows received.
+    std::vector<std::vector<char>> m_blocks;
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_ROW_DUMP_H_
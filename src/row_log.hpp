@@ -0,0 +1,331 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file row_log.hpp
+ * @brief Row store for logging, delta encoding times and run-length encoding unchanged rows.
+ */
+
+#ifndef FCPP_MIOSIX_ROW_LOG_H_
+#define FCPP_MIOSIX_ROW_LOG_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "lib/settings.hpp"
+#include "lib/common/serialize.hpp"
+#include "lib/common/tagged_tuple.hpp"
+#include "lib/common/traits.hpp"
+#include "lib/component/base.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace for plotting and logging facilities.
+namespace plot {
+
+
+/**
+ * @brief Names of the columns printed by a logged type, if not just the name of its tag.
+ *
+ * Types printing several columns (as `bitpack`) can specialise this template, so that
+ * the printed header names every column, e.g.
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~{.cpp}
+ * template <>
+ * struct column_names<my_pack> {
+ *     static char const* get() { return "first second"; }
+ * };
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+template <typename T>
+struct column_names {
+    //! @brief The space-separated names (null to use the name of the tag).
+    static char const* get() {
+        return nullptr;
+    }
+};
+
+
+//! @cond INTERNAL
+namespace details {
+    //! @brief Appends a variable-length unsigned integer.
+    inline void append_varint(std::vector<char>& v, uint64_t x) {
+        for (; x >= 128; x >>= 7) v.push_back(char(x | 128));
+        v.push_back(char(x));
+    }
+
+    //! @brief Number of bytes of a variable-length unsigned integer.
+    inline size_t varint_size(uint64_t x) {
+        size_t n = 1;
+        for (; x >= 128; x >>= 7) ++n;
+        return n;
+    }
+
+    //! @brief Reads a variable-length unsigned integer at a position, advancing it (false on error).
+    inline bool read_varint(char const* v, size_t size, size_t& p, uint64_t& x) {
+        x = 0;
+        for (size_t i = 0; p < size and i < 10; ++i) {
+            char c = v[p++];
+            x |= uint64_t(c & 127) << (7*i);
+            if ((c & 128) == 0) return true;
+        }
+        return false;
+    }
+
+    //! @brief Maps signed integers to unsigned ones, so that small magnitudes stay small.
+    inline uint64_t zigzag(int64_t x) {
+        return (uint64_t(x) << 1) ^ uint64_t(x >> 63);
+    }
+
+    //! @brief Inverse of `zigzag`.
+    inline int64_t unzigzag(uint64_t x) {
+        return int64_t(x >> 1) ^ -int64_t(x & 1);
+    }
+
+    //! @brief Operations on the columns of a row, given as tag-type pairs.
+    template <typename... Ss>
+    struct row_columns;
+
+    //! @brief Operations on an empty set of columns.
+    template <>
+    struct row_columns<> {
+        template <typename R>
+        static void write(common::osstream&, R const&) {}
+        static void read(common::isstream&, std::ostream&) {}
+        static void names(std::ostream&) {}
+    };
+
+    //! @brief Operations on the columns of a row.
+    template <typename S, typename T, typename... Ss>
+    struct row_columns<S, T, Ss...> {
+        //! @brief Serialises the columns of a row.
+        template <typename R>
+        static void write(common::osstream& os, R const& row) {
+            os << T(common::get<S>(row));
+            row_columns<Ss...>::write(os, row);
+        }
+
+        //! @brief Deserialises and prints the columns of a row.
+        static void read(common::isstream& is, std::ostream& o) {
+            T x;
+            is >> x;
+            o << x << " ";
+            row_columns<Ss...>::read(is, o);
+        }
+
+        //! @brief Prints the names of the columns.
+        static void names(std::ostream& o) {
+            if (char const* n = column_names<T>::get()) {
+                o << n << " ";
+                return row_columns<Ss...>::names(o);
+            }
+            std::string s = common::type_name<S>();
+            size_t p = s.rfind("::");
+            o << (p == std::string::npos ? s : s.substr(p + 2)) << " ";
+            row_columns<Ss...>::names(o);
+        }
+    };
+}
+//! @endcond
+
+
+/**
+ * @brief Row store of at most `capacity` bytes, with a time column `T` followed by the columns in `S`.
+ *
+ * Times are stored as differences from the previous row, in `resolution` units of a second.
+ * A row whose columns are equal to the previous one is not stored: it extends a run of
+ * equal rows with the same time difference. Rows not fitting the store are dropped, and
+ * the store never grows past its capacity (reserved on construction).
+ * Printing decodes the store row by row, in the same text format of `plot::rows`.
+ */
+template <typename T, typename S, size_t capacity, intmax_t resolution = 1000000>
+class compressed_rows;
+
+//! @brief Row store with a time column, delta encoding times and run-length encoding unchanged rows.
+template <typename T, typename... Ss, size_t capacity, intmax_t resolution>
+class compressed_rows<T, component::tags::tuple_store<Ss...>, capacity, resolution> {
+  public:
+    //! @brief Number of bytes reserved for the store.
+    static constexpr size_t buffer_size = capacity;
+
+    //! @brief Constructor, reserving the store.
+    compressed_rows() {
+        m_data.reserve(capacity);
+    }
+
+    //! @brief Stores a row (given as a tagged tuple including the columns).
+    template <typename R>
+    compressed_rows& operator<<(R const& row) {
+        // the columns are serialised into a stream reused across rows, so that its buffer is not reallocated
+        std::vector<char>& cols = m_os.data();
+        cols.clear();
+        details::row_columns<Ss...>::write(m_os, row);
+        int64_t time = std::llround(double(common::get<T>(row)) * resolution);
+        int64_t delta = time - m_time;
+        uint64_t zdelta = details::zigzag(delta);
+        if (m_rows > 0 and cols == m_last) {
+            if (m_run != npos and m_run_delta == delta and m_run_count < max_run) {
+                ++m_run_count;
+                m_data[m_run + 1] = char(m_run_count & 255);
+                m_data[m_run + 2] = char(m_run_count >> 8);
+            } else {
+                if (m_data.size() + 3 + details::varint_size(zdelta) > capacity) return drop();
+                m_run = m_data.size();
+                m_data.push_back(char(record::run));
+                m_data.push_back(1);
+                m_data.push_back(0);
+                details::append_varint(m_data, zdelta);
+                m_run_count = 1;
+                m_run_delta = delta;
+            }
+        } else {
+            if (m_data.size() + 1 + details::varint_size(zdelta) + details::varint_size(cols.size()) + cols.size() > capacity) return drop();
+            m_data.push_back(char(record::row));
+            details::append_varint(m_data, zdelta);
+            details::append_varint(m_data, cols.size());
+            m_data.insert(m_data.end(), cols.begin(), cols.end());
+            m_last.assign(cols.begin(), cols.end());
+            m_run = npos;
+        }
+        m_time = time;
+        ++m_rows;
+        return *this;
+    }
+
+    //! @brief Number of bytes used by the store.
+    size_t byte_size() const {
+        return m_data.size();
+    }
+
+    //! @brief Number of rows stored.
+    size_t size() const {
+        return m_rows;
+    }
+
+    //! @brief Number of rows dropped for lack of space.
+    size_t dropped() const {
+        return m_dropped;
+    }
+
+    //! @brief The encoded rows.
+    std::vector<char> const& data() const {
+        return m_data;
+    }
+
+    //! @brief Calls `f(data, size)` on the encoded rows, as a single block.
+    template <typename F>
+    void for_each_block(F&& f) const {
+        f(m_data.data(), m_data.size());
+    }
+
+    //! @brief Removes all rows.
+    void clear() {
+        m_data.clear();
+        m_last.clear();
+        m_time = 0;
+        m_rows = 0;
+        m_dropped = 0;
+        m_run = npos;
+    }
+
+    //! @brief Prints the rows, decoding them one at a time.
+    void print(std::ostream& o) const {
+        print_header(o);
+        decode(o, m_data.data(), m_data.size());
+        if (m_dropped > 0) o << "# " << m_dropped << " rows dropped" << std::endl;
+    }
+
+    //! @brief Prints the header describing the columns.
+    static void print_header(std::ostream& o) {
+        o << "#" << std::endl << "# The columns have the following meaning:" << std::endl << "# ";
+        details::row_columns<T, times_t, Ss...>::names(o);
+        o << std::endl;
+    }
+
+    //! @brief Prints the rows encoded in a sequence of bytes, decoding them one at a time.
+    static void decode(std::ostream& o, char const* data, size_t size) {
+        int64_t time = 0;
+        std::vector<char> last;
+        for (size_t p = 0; p < size; ) {
+            uint64_t delta, len;
+            if (data[p++] == char(record::row)) {
+                if (not details::read_varint(data, size, p, delta) or not details::read_varint(data, size, p, len) or p + len > size) break;
+                last.assign(data + p, data + p + len);
+                p += len;
+                time += details::unzigzag(delta);
+                print_row(o, time, last);
+            } else {
+                if (p + 2 > size) break;
+                size_t count = uint8_t(data[p]) + 256 * uint8_t(data[p+1]);
+                p += 2;
+                if (not details::read_varint(data, size, p, delta)) break;
+                for (size_t i = 0; i < count; ++i) {
+                    time += details::unzigzag(delta);
+                    print_row(o, time, last);
+                }
+            }
+        }
+    }
+
+  private:
+    //! @brief Kinds of records in the store.
+    enum class record : char {
+        row,    //!< time difference, size and serialised columns of a row
+        run     //!< count (two bytes) and time difference of rows equal to the previous one
+    };
+
+    //! @brief Marker of no open run.
+    static constexpr size_t npos = size_t(-1);
+
+    //! @brief Maximum number of rows in a run.
+    static constexpr size_t max_run = 65535;
+
+    //! @brief Prints a row.
+    static void print_row(std::ostream& o, int64_t time, std::vector<char> const& cols) {
+        o << double(time) / resolution << " ";
+        common::isstream is{std::vector<char>(cols)};
+        details::row_columns<Ss...>::read(is, o);
+        o << std::endl;
+    }
+
+    //! @brief Drops the last row.
+    compressed_rows& drop() {
+        ++m_dropped;
+        return *this;
+    }
+
+    //! @brief The encoded rows.
+    std::vector<char> m_data;
+    //! @brief The serialised columns of the last row.
+    std::vector<char> m_last;
+    //! @brief Stream serialising the columns of the current row.
+    common::osstream m_os;
+    //! @brief The time of the last row, in resolution units.
+    int64_t m_time = 0;
+    //! @brief Number of rows stored.
+    size_t m_rows = 0;
+    //! @brief Number of rows dropped.
+    size_t m_dropped = 0;
+    //! @brief Position of the open run record (npos if none).
+    size_t m_run = npos;
+    //! @brief Number of rows in the open run.
+    size_t m_run_count = 0;
+    //! @brief Time difference of the rows in the open run.
+    int64_t m_run_delta = 0;
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_ROW_LOG_H_
@@ -0,0 +1,136 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lib/settings.hpp"
+#include "lib/common/tagged_tuple.hpp"
+
+#include "row_log.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+    //! @brief Tags of the columns of the checked rows.
+    namespace tags {
+        //! @brief Time of a row.
+        struct row_time {};
+        //! @brief A device.
+        struct row_device {};
+        //! @brief A small integer.
+        struct row_count {};
+        //! @brief A real number.
+        struct row_value {};
+    }
+
+    //! @brief Resolution of times in the checked stores.
+    constexpr intmax_t resolution = 1000000;
+
+    //! @brief Row stores of a given capacity.
+    template <size_t capacity>
+    using row_store = plot::compressed_rows<tags::row_time, component::tags::tuple_store<tags::row_device, device_t, tags::row_count, int, tags::row_value, real_t>, capacity, resolution>;
+
+    //! @brief Type of the checked rows.
+    using row_type = common::tagged_tuple_t<tags::row_time, times_t, tags::row_device, device_t, tags::row_count, int, tags::row_value, real_t>;
+
+    //! @brief Generates rows with runs of unchanged columns, regular periods and jitter.
+    inline std::vector<row_type> make_rows(size_t n) {
+        std::mt19937 rng(42);
+        std::vector<row_type> rows;
+        times_t t = 0;
+        device_t d = 1;
+        int c = 0;
+        real_t v = 0;
+        for (size_t i = 0; i < n; ++i) {
+            t += rng() % 8 == 0 ? (rng() % 1000) / 997.0 : 0.25;
+            if (rng() % 5 == 0) d = device_t(rng() % 100);
+            if (rng() % 7 == 0) c = int(rng() % 2000) - 1000;
+            if (rng() % 11 == 0) v = (rng() % 10000) / 64.0;
+            rows.push_back(common::make_tagged_tuple<tags::row_time, tags::row_device, tags::row_count, tags::row_value>(t, d, c, v));
+        }
+        return rows;
+    }
+
+    //! @brief The text lines expected from decoding rows.
+    inline std::vector<std::string> expected_lines(std::vector<row_type> const& rows) {
+        std::vector<std::string> lines;
+        for (row_type const& r : rows) {
+            std::stringstream ss;
+            ss << double(std::llround(double(common::get<tags::row_time>(r)) * resolution)) / resolution << " ";
+            ss << common::get<tags::row_device>(r) << " " << common::get<tags::row_count>(r) << " " << common::get<tags::row_value>(r) << " ";
+            lines.push_back(ss.str());
+        }
+        return lines;
+    }
+
+    //! @brief The text lines decoded from a store.
+    template <typename S>
+    std::vector<std::string> decoded_lines(S const& store) {
+        std::stringstream ss;
+        S::decode(ss, store.data().data(), store.byte_size());
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(ss, line)) lines.push_back(line);
+        return lines;
+    }
+
+    //! @brief Whether some lines appear in order within other lines.
+    inline bool subsequence(std::vector<std::string> const& sub, std::vector<std::string> const& lines) {
+        size_t i = 0;
+        for (size_t j = 0; i < sub.size() and j < lines.size(); ++j)
+            if (sub[i] == lines[j]) ++i;
+        return i == sub.size();
+    }
+}
+
+
+/**
+ * @brief Checks that rows stored in `compressed_rows` decode to the rows stored.
+ *
+ * Rows are checked both in a store large enough for all of them, and in a small store
+ * which has to drop rows without growing past its capacity (rows fitting after a dropped
+ * one are still stored). Returns non-zero on failure.
+ */
+int main() {
+    using namespace fcpp;
+
+    constexpr size_t n = 5000;
+    std::vector<row_type> rows = make_rows(n);
+    std::vector<std::string> lines = expected_lines(rows);
+    int failures = 0;
+    auto check = [&](bool ok, char const* what) {
+        if (not ok) {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    };
+
+    row_store<256*1024> large;
+    for (auto const& r : rows) large << r;
+    check(large.size() == n and large.dropped() == 0, "all rows stored in a large store");
+    check(decoded_lines(large) == lines, "rows decoded from a large store");
+    std::cout << n << " rows in " << large.byte_size() << " bytes" << std::endl;
+
+    row_store<1024> small;
+    size_t reserved = small.data().capacity();
+    for (auto const& r : rows) small << r;
+    check(small.size() + small.dropped() == n and small.dropped() > 0, "rows stored or dropped in a small store");
+    check(small.byte_size() <= 1024 and small.data().capacity() == reserved, "small store within its capacity");
+    std::vector<std::string> kept = decoded_lines(small);
+    check(kept.size() == small.size() and subsequence(kept, lines), "rows decoded from a small store");
+    std::cout << small.size() << " rows in " << small.byte_size() << " bytes, " << small.dropped() << " dropped" << std::endl;
+
+    small.clear();
+    for (size_t i = 0; i < 10; ++i) small << rows[i];
+    check(decoded_lines(small) == std::vector<std::string>(lines.begin(), lines.begin() + 10), "rows decoded after clearing a store");
+
+    if (failures == 0) std::cout << "all checks passed" << std::endl;
+    return failures;
+}
@@ -0,0 +1,99 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "simulation.hpp"
+#include "row_dump.hpp"
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+    //! @brief Converts a decoded row into CSV, quoting bracketed columns.
+    inline std::string csv_row(std::string const& line) {
+        std::string res;
+        int depth = 0;
+        for (size_t i = 0; i < line.size(); ++i) {
+            char c = line[i];
+            if (c == '[' and depth++ == 0) res += '"';
+            if (depth == 0 and c == ' ') {
+                if (i + 1 < line.size()) res += ',';
+                continue;
+            }
+            res += c;
+            if (c == ']' and --depth == 0) res += '"';
+        }
+        return res;
+    }
+
+    //! @brief Prints the rows of the blocks of a dump, as text or CSV.
+    inline void print_blocks(std::ostream& o, std::vector<std::vector<char>> const& blocks, bool csv) {
+        if (not csv) {
+            for (auto const& b : blocks) option::rows_type::decode(o, b.data(), b.size());
+            return;
+        }
+        std::stringstream ss;
+        for (auto const& b : blocks) option::rows_type::decode(ss, b.data(), b.size());
+        std::string line;
+        while (std::getline(ss, line)) o << csv_row(line) << std::endl;
+    }
+
+    //! @brief Prints the rows of a dump read, as text or CSV.
+    inline void print_dump(std::ostream& o, os::dump_reader const& reader, bool csv) {
+        if (not csv) option::rows_type::print_header(o);
+        print_blocks(o, reader.blocks(), csv);
+        if (csv) return;
+        if (reader.dropped() > 0) o << "# " << reader.dropped() << " rows dropped" << std::endl;
+        if (reader.lost() > 0) o << "# " << reader.lost() << " frames lost" << std::endl;
+    }
+}
+
+
+/**
+ * @brief Decodes the row dumps in a console log (from a file or the standard input).
+ *
+ * Other lines are copied unchanged, so that the output is as in the text log. With `-c`,
+ * only the rows are written, in CSV format.
+ */
+int main(int argc, char** argv) {
+    using namespace fcpp;
+
+    bool csv = false;
+    char const* file = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "-c") csv = true;
+        else file = argv[i];
+    }
+    std::ifstream fin;
+    if (file) {
+        fin.open(file);
+        if (not fin) {
+            std::cerr << "cannot open " << file << std::endl;
+            return 1;
+        }
+    }
+    std::istream& in = file ? fin : std::cin;
+    if (csv) {
+        std::stringstream ss;
+        option::rows_type::print_header(ss);
+        std::string line;
+        while (std::getline(ss, line)) if (line.size() > 2) std::cout << csv_row(line.substr(2)) << std::endl;
+    }
+    os::dump_reader reader;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (not reader.read(line)) {
+            if (not csv) std::cout << line << std::endl;
+        } else if (reader.ended()) print_dump(std::cout, reader, csv);
+    }
+    // a capture may end in the middle of a dump
+    if (reader.dumping()) {
+        print_dump(std::cout, reader, csv);
+        if (not csv) std::cout << "# dump truncated" << std::endl;
+    }
+    return 0;
+}
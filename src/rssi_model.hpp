@@ -0,0 +1,143 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file rssi_model.hpp
+ * @brief Calibrated log-distance path loss model, turning received power into distance.
+ */
+
+#ifndef FCPP_MIOSIX_RSSI_MODEL_H_
+#define FCPP_MIOSIX_RSSI_MODEL_H_
+
+#include <cmath>
+#include <cstddef>
+
+#include "lib/settings.hpp"
+
+//! @brief Received power in dBm below which frames are discarded.
+#ifndef FCPP_MIOSIX_RSSI_THRESHOLD
+#define FCPP_MIOSIX_RSSI_THRESHOLD -75
+#endif
+
+//! @brief Received power in dBm at one meter, with transmission power `FCPP_MIOSIX_RSSI_TX_POWER`.
+#ifndef FCPP_MIOSIX_RSSI_AT_1M
+#define FCPP_MIOSIX_RSSI_AT_1M -45
+#endif
+
+//! @brief Transmission power in dBm at which `FCPP_MIOSIX_RSSI_AT_1M` has been calibrated.
+#ifndef FCPP_MIOSIX_RSSI_TX_POWER
+#define FCPP_MIOSIX_RSSI_TX_POWER 5
+#endif
+
+//! @brief Path loss exponent (2 in free space, higher indoors).
+#ifndef FCPP_MIOSIX_PATH_LOSS_EXPONENT
+#define FCPP_MIOSIX_PATH_LOSS_EXPONENT 2.5
+#endif
+
+//! @brief Standard deviation in dBm of the received power around the model (shadowing).
+#ifndef FCPP_MIOSIX_RSSI_SPREAD
+#define FCPP_MIOSIX_RSSI_SPREAD 4
+#endif
+
+//! @brief Comma-separated `{uid, dB}` pairs with the power offsets of individual boards (as printed by the calibration tool).
+#ifndef FCPP_MIOSIX_RSSI_OFFSETS
+#define FCPP_MIOSIX_RSSI_OFFSETS
+#endif
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+//! @brief Power offset of a board, added both when transmitting and receiving.
+struct board_offset {
+    //! @brief The board.
+    device_t uid;
+    //! @brief The offset in dB.
+    real_t offset;
+};
+
+
+/**
+ * @brief Log-distance path loss model with per-board offsets.
+ *
+ * The power received from a sender at distance `d` is modelled as
+ * `rssi0 + power - tx_power - 10 * exponent * log10(d) + offset(sender) + offset(receiver)`,
+ * where `power` is the transmission power (the same for all devices), and the remaining parameters are
+ * fitted by the calibration tool. Link confidence is the probability that the power
+ * exceeds the threshold, assuming a gaussian shadowing with standard deviation `spread`.
+ */
+class rssi_model {
+  public:
+    //! @brief Sets the UID of the device, and the transmission power in dBm.
+    void configure(device_t id, real_t power) {
+        m_uid = id;
+        m_power = power;
+    }
+
+    //! @brief The power offset of a board.
+    real_t offset(device_t id) const {
+        static const board_offset offsets[] = {{0, 0}, FCPP_MIOSIX_RSSI_OFFSETS};
+        for (size_t i = 1; i < sizeof(offsets) / sizeof(board_offset); ++i)
+            if (offsets[i].uid == id) return offsets[i].offset;
+        return 0;
+    }
+
+    //! @brief The received power expected from a sender at a given distance.
+    real_t rssi(real_t distance, device_t sender) const {
+        using std::log10;
+        return reference(sender) - 10 * exponent * log10(distance);
+    }
+
+    //! @brief The estimated distance of a sender, given the received power.
+    real_t distance(real_t rssi, device_t sender) const {
+        using std::pow;
+        return pow(real_t(10), (reference(sender) - rssi) / (10 * exponent));
+    }
+
+    //! @brief The probability that a link with a given average received power is above the threshold.
+    real_t confidence(real_t rssi) const {
+        using std::erfc;
+        using std::sqrt;
+        return real_t(0.5) * erfc((threshold - rssi) / (spread * sqrt(real_t(2))));
+    }
+
+    //! @brief Received power in dBm at one meter.
+    real_t rssi0 = FCPP_MIOSIX_RSSI_AT_1M;
+    //! @brief Path loss exponent.
+    real_t exponent = FCPP_MIOSIX_PATH_LOSS_EXPONENT;
+    //! @brief Received power below which frames are discarded.
+    real_t threshold = FCPP_MIOSIX_RSSI_THRESHOLD;
+    //! @brief Standard deviation of the received power around the model.
+    real_t spread = FCPP_MIOSIX_RSSI_SPREAD;
+
+  private:
+    //! @brief The received power expected from a sender at one meter.
+    real_t reference(device_t sender) const {
+        return rssi0 + m_power - FCPP_MIOSIX_RSSI_TX_POWER + offset(sender) + offset(m_uid);
+    }
+
+    //! @brief The UID of the device.
+    device_t m_uid = 0;
+    //! @brief The transmission power.
+    real_t m_power = FCPP_MIOSIX_RSSI_TX_POWER;
+};
+
+//! @brief The path loss model of the device.
+inline rssi_model& rssi_calibration() {
+    static rssi_model m;
+    return m;
+}
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_RSSI_MODEL_H_
@@ -3,7 +3,16 @@
 #define RUN_VULNERABILITY_DETECTION
 #define RUN_CONTACT_TRACING
 
+//! @brief Channel model: 0 for ideal links, 1 to replay the links recorded in `input/`, 2 for Markov links fitted on them.
+#ifndef CHANNEL_MODEL
+#define CHANNEL_MODEL 0
+#endif
+
+#include <chrono>
+
 #include "main.hpp"
+#include "quiet_connector.hpp"
+#include "recorded_connector.hpp"
 
 /**
  * @brief Namespace containing all the objects in the FCPP library.
@@ -42,6 +51,24 @@ inline bool buttonPressed(device_t uid, uint16_t t) {
 //! @brief Turn on or off the red LED.
 inline void setRedLed(bool) {}
 
+//! @brief Notifies the driver of the global clock value corresponding to a local time.
+inline void syncClock(times_t, times_t) {}
+
+//! @brief The global clock value corresponding to a local time (clocks are in sync in simulation).
+inline times_t globalClock(times_t local) {
+    return local;
+}
+
+//! @brief A counter of nanoseconds (as CPU cycles are not available in simulation).
+inline uint32_t cycleCount() {
+    return uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//! @brief The quality of the link from a neighbour at a given time (ideal in simulation).
+inline os::link_quality linkQuality(device_t, times_t) {
+    return {1, 0, 1, 0, 1};
+}
+
 //! @brief Namespace containing the libraries of coordination routines.
 namespace coordination {
 
@@ -57,7 +84,37 @@ namespace tags {
     struct log_buffer_size{};
     //! @brief The length of the logging buffer object.
     struct log_buffer_len{};
+    //! @brief Whether the message of the current round is suppressed (skipped or replaced by a heartbeat), being unchanged.
+    struct msg_saved {};
+    //! @brief Rounds until an unchanged message is sent again (the delay for neighbours having lost it).
+    struct refresh_delay {};
+}
+
+/**
+ * @brief Suppresses unchanged messages as the driver does, tracking the messages saved and the delay added.
+ *
+ * Messages are considered unchanged when the values shared with neighbours are, and are then
+ * skipped by the connector except for heartbeats (every HEARTBEAT_PERIOD rounds) and refreshes
+ * (every REFRESH_PERIOD rounds), which deliver the message again as receivers replay their copy.
+ */
+FUN void quiescence_tracking(ARGS) { CODE
+    using namespace tags;
+    // the messages of the main program change when these values change
+    auto shared = make_tuple(
+        node.storage(min_uid{}), node.storage(hop_dist{}), node.storage(im_weak{}), node.storage(some_weak{}), node.storage(positives{}),
+        node.storage(max_stack{}), node.storage(max_heap{}), node.storage(max_msg{}), node.storage(round_period{})
+    );
+    bool unchanged = old(CALL, shared) == shared;
+    int quiet = old(CALL, 0, [&](int q){
+        return unchanged ? q + 1 : 0;
+    });
+    bool suppressing = HEARTBEAT_PERIOD > 0 and quiet > 0;
+    bool refresh = REFRESH_PERIOD > 0 and quiet % REFRESH_PERIOD == 0;
+    node.storage(msg_saved{}) = suppressing and not refresh;
+    node.connector_data().quiet = suppressing and not refresh and quiet % (HEARTBEAT_PERIOD > 0 ? HEARTBEAT_PERIOD : 1) != 0;
+    node.storage(refresh_delay{}) = not suppressing ? 0 : REFRESH_PERIOD > 0 ? REFRESH_PERIOD - quiet % REFRESH_PERIOD : quiet;
 }
+FUN_EXPORT quiescence_tracking_t = export_list<tuple<device_t, hops_t, bool, bool, positive_t, uint16_t, uint32_t, uint8_t, times_t>, int>;
 
 //! @brief Handle for simulation code.
 FUN void simulation_handle(ARGS) { CODE
@@ -68,6 +125,11 @@ FUN void simulation_handle(ARGS) { CODE
     node.storage(log_buffer{}) << node.storage_tuple();
     node.storage(log_buffer_size{}) = node.storage(log_buffer{}).byte_size();
     node.storage(log_buffer_len{}) = node.storage(log_buffer{}).size();
+    quiescence_tracking(CALL);
+#if CHANNEL_MODEL > 0
+    node.connector_data().base.uid = node.uid;
+    node.connector_data().base.time = node.current_time();
+#endif
 
     int column = constant(CALL, (int8_t)node.next_int(0, 3));
     int row = constant(CALL, (int8_t)node.next_int(0, 1));
@@ -99,7 +161,7 @@ FUN void simulation_handle(ARGS) { CODE
     t = constant(CALL, node.next_real(4*time_frame, 5*time_frame));
     if (node.current_time() > t) node.terminate();
 }
-FUN_EXPORT simulation_handle_t = export_list<constant_t<vec<dim>>, constant_t<real_t>, follow_path_t>;
+FUN_EXPORT simulation_handle_t = export_list<constant_t<vec<dim>>, constant_t<real_t>, follow_path_t, quiescence_tracking_t>;
 
 } // namespace coordination
 
@@ -107,6 +169,16 @@ FUN_EXPORT simulation_handle_t = export_list<constant_t<vec<dim>>, constant_t<re
 //! @brief Namespace for component options.
 namespace option {
 
+//! @brief Ideal connection predicate, within a fixed radius with a probability decreasing with distance.
+using radial_c = connect::radial<70, connect::fixed<12, 1, dim>>;
+
+//! @brief Connection predicate, according to the channel model, dropping suppressed messages.
+#if CHANNEL_MODEL > 0
+using connector_c = connect::quiet<connect::recorded<radial_c, CHANNEL_MODEL == 2>>;
+#else
+using connector_c = connect::quiet<radial_c>;
+#endif
+
 //! @brief Description of the export schedule.
 using export_s = sequence::periodic_n<1, 0, 1, end_time>;
 
@@ -126,7 +198,9 @@ using storage_t = tuple_store<
     size,               double,
     log_buffer,         rows_type,
     log_buffer_size,    size_t,
-    log_buffer_len,     size_t
+    log_buffer_len,     size_t,
+    msg_saved,          bool,
+    refresh_delay,      int
 >;
 
 //! @brief Storage tags to be logged with aggregators.
@@ -140,7 +214,10 @@ using aggregator_t = aggregators<
     degree,         aggregator::combine<aggregator::min<int>, aggregator::mean<double>, aggregator::max<int>>,
     max_msg,        aggregator::mean<double>,
     log_buffer_size,aggregator::combine<aggregator::max<int>, aggregator::mean<double>>,
-    log_buffer_len, aggregator::combine<aggregator::mean<double>, aggregator::max<int>>
+    log_buffer_len, aggregator::combine<aggregator::mean<double>, aggregator::max<int>>,
+    round_period,   aggregator::combine<aggregator::min<double>, aggregator::mean<double>, aggregator::max<double>>,
+    msg_saved,      aggregator::mean<double>,
+    refresh_delay,  aggregator::combine<aggregator::mean<double>, aggregator::max<int>>
 >;
 
 //! @brief Plotting variables over time.
@@ -148,7 +225,7 @@ template <typename... Ts>
 using time_plot_t = plot::split<plot::time, plot::values<aggregator_t, common::type_sequence<>, Ts...>>;
 
 //! @brief Overall plot description.
-using plotter_t = plot::join<time_plot_t<im_weak, some_weak>, time_plot_t<degree>, time_plot_t<infected, infector>>;
+using plotter_t = plot::join<time_plot_t<im_weak, some_weak>, time_plot_t<degree>, time_plot_t<infected, infector>, time_plot_t<msg_saved>, time_plot_t<refresh_delay>, time_plot_t<round_period>>;
 
 //! @brief Main FCPP option setup.
 DECLARE_OPTIONS(simulation,
@@ -158,7 +235,7 @@ DECLARE_OPTIONS(simulation,
     synchronised<false>,
     message_size<true>,
     dimension<dim>,
-    connector<connect::radial<70, connect::fixed<12, 1, dim>>>,
+    connector<connector_c>,
     log_schedule<export_s>,
     spawn_schedule<spawn_s>,
     init<x, rectangle_d>,
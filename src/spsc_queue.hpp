@@ -0,0 +1,108 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file spsc_queue.hpp
+ * @brief Lock-free queue between a single producer thread and a single consumer thread.
+ */
+
+#ifndef FCPP_MIOSIX_SPSC_QUEUE_H_
+#define FCPP_MIOSIX_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+/**
+ * @brief Fixed-capacity ring of `N` objects of type `T`, pushed by one thread and popped by another.
+ *
+ * Objects are constructed once and reused in place: the producer fills `back()` and publishes
+ * it through `push()`, the consumer reads `front()` and releases it through `pop()`.
+ * No operation blocks or allocates, so that it can be used from a high-priority thread.
+ */
+template <typename T, size_t N>
+class spsc_queue {
+    static_assert(N > 0 and (N & (N-1)) == 0, "the capacity of a queue must be a power of two");
+
+  public:
+    //! @brief Maximum number of objects in the queue.
+    static constexpr size_t capacity = N;
+
+    //! @brief The slot to be filled by the producer (null if the queue is full).
+    T* back() {
+        size_t t = m_tail.load(std::memory_order_relaxed);
+        if (t - m_head.load(std::memory_order_acquire) == N) return nullptr;
+        return &m_data[t % N];
+    }
+
+    //! @brief Publishes the slot returned by `back()` to the consumer.
+    void push() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //! @brief Moves an object into the queue, returning false if the queue is full.
+    bool push(T&& x) {
+        T* p = back();
+        if (p == nullptr) return false;
+        *p = std::move(x);
+        push();
+        return true;
+    }
+
+    //! @brief The oldest slot published by the producer (null if the queue is empty).
+    T* front() {
+        size_t h = m_head.load(std::memory_order_relaxed);
+        if (h == m_tail.load(std::memory_order_acquire)) return nullptr;
+        return &m_data[h % N];
+    }
+
+    //! @brief Releases the slot returned by `front()` to the producer.
+    void pop() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //! @brief Moves the oldest object out of the queue, returning false if the queue is empty.
+    bool pop(T& x) {
+        T* p = front();
+        if (p == nullptr) return false;
+        x = std::move(*p);
+        pop();
+        return true;
+    }
+
+    //! @brief Number of objects in the queue (approximate while the other thread is active).
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    //! @brief Whether the queue is empty (approximate while the other thread is active).
+    bool empty() const {
+        return size() == 0;
+    }
+
+  private:
+    //! @brief Number of objects ever popped (written by the consumer only).
+    std::atomic<size_t> m_head{0};
+    //! @brief Number of objects ever pushed (written by the producer only).
+    std::atomic<size_t> m_tail{0};
+    //! @brief The slots.
+    T m_data[N];
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_SPSC_QUEUE_H_
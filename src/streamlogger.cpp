@@ -28,16 +28,98 @@
 #include "streamlogger.hpp"
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
 using namespace std;
 
+static int roundToPowerOfTwo(int x)
+{
+    int result = 1;
+    while(result < x) result *= 2;
+    return result;
+}
+
+LogStreambuf::LogStreambuf(int capacity, Mode mode)
+    : capacity(mode == Mode::Ring ? roundToPowerOfTwo(capacity) : capacity), mode(mode)
+{
+    if(mode == Mode::Ring) ring.reset(new char[this->capacity]);
+    else log.reserve(capacity);
+}
+
+int LogStreambuf::size() const
+{
+    if(mode == Mode::Append) return log.size();
+    return min<unsigned int>(head.load(memory_order_relaxed), capacity);
+}
+
 void LogStreambuf::dump()
 {
-    cout << log << endl;
+    if(mode == Mode::Append)
+    {
+        cout << log << endl;
+        return;
+    }
+    unsigned int h = head.load();
+    writeRange(h - min<unsigned int>(h, capacity), h);
+    cout << endl;
+}
+
+void LogStreambuf::write(const char *s, streamsize n)
+{
+    if(mode == Mode::Append)
+    {
+        xsputn(s, n);
+        return;
+    }
+    // Announce the write before reserving space, so that flushMirror() can
+    // tell whether all the reserved bytes have been written
+    writers.fetch_add(1);
+    unsigned int start = head.fetch_add(n);
+    if(n > capacity)
+    {
+        // Only the last capacity bytes would survive anyway
+        start += n - capacity;
+        s += n - capacity;
+        n = capacity;
+    }
+    unsigned int offset = start & (capacity - 1);
+    unsigned int first = min<unsigned int>(n, capacity - offset);
+    memcpy(&ring[offset], s, first);
+    memcpy(&ring[0], s + first, n - first);
+    writers.fetch_sub(1);
+}
+
+void LogStreambuf::flushMirror()
+{
+    if(mode == Mode::Append) return;
+    unsigned int h = head.load();
+    if(h == mirrored || writers.load() != 0) return;
+    if(h - mirrored > static_cast<unsigned int>(capacity))
+    {
+        lostBytes += h - mirrored - capacity;
+        mirrored = h - capacity;
+    }
+    writeRange(mirrored, h);
+    cout.flush();
+    mirrored = h;
+}
+
+void LogStreambuf::writeRange(unsigned int from, unsigned int to)
+{
+    unsigned int offset = from & (capacity - 1);
+    unsigned int n = to - from;
+    unsigned int first = min<unsigned int>(n, capacity - offset);
+    cout.write(&ring[offset], first);
+    cout.write(&ring[0], n - first);
 }
     
 streamsize LogStreambuf::xsputn(const char *s, streamsize n)
 {
+    if(mode == Mode::Ring)
+    {
+        write(s, n);
+        return n;
+    }
     cout.write(s, n);
     auto loggable = min<streamsize>(n, capacity - size());
     log.append(s, loggable);
@@ -49,6 +131,11 @@ int LogStreambuf::overflow(int c)
     if(c != EOF)
     {
         char cc = static_cast<char>(c);
+        if(mode == Mode::Ring)
+        {
+            write(&cc, 1);
+            return c;
+        }
         cout.write(&cc, 1);
         if(size() < capacity) log.append(&cc, 1);
     }
@@ -66,5 +153,11 @@ int main()
     
     cout << "----" << endl;
     log.dump();
+
+    LogStreambuf ring(64, LogStreambuf::Mode::Ring);
+    ostream rs(&ring);
+    for(int i = 0; i < 20; i++) rs << "Line " << i << "\n";
+    cout << "----" << endl;
+    ring.flushMirror(); // Only the last 64 bytes are left
 }
 #endif
@@ -27,17 +27,46 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <ostream>
 #include <string>
 
+/**
+ * A streambuf keeping a log of what is written into it.
+ * In Append mode, the first capacity bytes are kept and everything is also
+ * written to cout as it arrives. In Ring mode, the last capacity bytes
+ * (rounded up to a power of two) are kept, writing is lock-free and can be
+ * done from several threads or from interrupt context through write(), and
+ * bytes are mirrored to cout in batches only when flushMirror() is called.
+ */
 class LogStreambuf : public std::streambuf
 {
 public:
-    explicit LogStreambuf(int capacity) : capacity(capacity) { log.reserve(capacity); }
+    enum class Mode { Append, Ring };
+
+    explicit LogStreambuf(int capacity, Mode mode = Mode::Append);
     
     void dump();
     
-    int size() const { return log.size(); }
+    int size() const;
+
+    /**
+     * Writes into the log. In Ring mode it never blocks nor allocates, and
+     * bytes written concurrently with dump() or flushMirror() may be missed
+     * or seen partially by them.
+     */
+    void write(const char *s, std::streamsize n);
+
+    /**
+     * In Ring mode, writes to cout the bytes logged since the last call, if
+     * no write is in progress (otherwise they are left to the next call).
+     * Nothing is done if no bytes were logged, so it can be called often.
+     */
+    void flushMirror();
+
+    /// Bytes overwritten in Ring mode before being mirrored to cout.
+    unsigned int lost() const { return lostBytes; }
     
 protected:
 
@@ -46,6 +75,14 @@ protected:
     int overflow(int c) override;
     
 private:
+    void writeRange(unsigned int from, unsigned int to);
+
     std::string log;
     int capacity;
+    Mode mode;
+    std::unique_ptr<char[]> ring;
+    std::atomic<unsigned int> head{0};    ///< Total bytes reserved in Ring mode
+    std::atomic<unsigned int> writers{0}; ///< Writes in progress in Ring mode
+    unsigned int mirrored = 0;            ///< Bytes mirrored to cout in Ring mode
+    unsigned int lostBytes = 0;
 };
@@ -0,0 +1,154 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file tdma.hpp
+ * @brief Slotted medium access, with slots aligned to the global clock.
+ */
+
+#ifndef FCPP_MIOSIX_TDMA_H_
+#define FCPP_MIOSIX_TDMA_H_
+
+#include <cmath>
+#include <cstdint>
+
+#include "lib/settings.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+//! @brief Namespace containing OS-dependent functionalities.
+namespace os {
+
+
+/**
+ * @brief Schedule of transmit and listen slots within a period of the global clock.
+ *
+ * Every device transmits in its own slot, initially derived from its UID. Whenever a device
+ * with lower UID is heard in the same slot, the slot is moved to one where no neighbour has
+ * been heard recently. The radio listens only in its own slot and in slots where neighbours
+ * have been heard in the last few periods, except for one discovery period every
+ * `discovery` in which every slot is listened.
+ */
+class tdma_schedule {
+  public:
+    //! @brief Maximum number of slots in a period.
+    static constexpr size_t max_slots = 64;
+
+    //! @brief Number of periods after which a slot where nobody has been heard is considered free.
+    static constexpr int stale_periods = 3;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param uid The UID of the device.
+     * @param period The period of the schedule (in seconds).
+     * @param slots The number of slots in a period.
+     * @param discovery The number of periods between discovery periods.
+     */
+    tdma_schedule(device_t uid, times_t period, size_t slots, size_t discovery)
+        : m_uid(uid), m_period(period), m_slots(slots < max_slots ? slots : max_slots), m_discovery(discovery), m_slot(uid % m_slots) {
+        for (size_t i = 0; i < m_slots; ++i) m_heard[i] = -(stale_periods + 1) * m_period;
+    }
+
+    //! @brief The transmit slot of the device.
+    size_t slot() const {
+        return m_slot;
+    }
+
+    //! @brief The length of a slot.
+    times_t slot_length() const {
+        return m_period / m_slots;
+    }
+
+    //! @brief Whether the device can transmit at a given global time.
+    bool transmitting(times_t t) const {
+        size_t s;
+        times_t offs = offset(t, s);
+        return s == m_slot and offs >= guard() and offs <= slot_length() - guard();
+    }
+
+    /**
+     * @brief Whether the device should listen at a given global time.
+     *
+     * Sets `until` to the global time at which the answer may change.
+     */
+    bool listening(times_t t, times_t& until) const {
+        size_t s;
+        times_t offs = offset(t, s);
+        times_t start = t - offs;
+        if (s == m_slot and offs < guard()) {
+            until = start + guard();
+            return false;
+        }
+        until = start + slot_length();
+        if (needed(t, s)) return true;
+        for (size_t i = 1; i < m_slots; ++i) {
+            if (needed(until, (s + i) % m_slots)) break;
+            until += slot_length();
+        }
+        return false;
+    }
+
+    //! @brief Records that a device has been heard at a given global time.
+    void heard(device_t d, times_t t) {
+        size_t s;
+        offset(t, s);
+        m_heard[s] = t;
+        if (s == m_slot and d < m_uid) {
+            for (size_t i = 1; i < m_slots; ++i) {
+                size_t n = (m_slot + i) % m_slots;
+                if (t - m_heard[n] > stale_periods * m_period) {
+                    m_slot = n;
+                    break;
+                }
+            }
+        }
+    }
+
+  private:
+    //! @brief Time left at the slot borders to absorb synchronisation errors.
+    times_t guard() const {
+        return slot_length() / 8;
+    }
+
+    //! @brief The offset of a global time within its slot, setting the slot index.
+    times_t offset(times_t t, size_t& s) const {
+        using std::floor;
+        times_t p = t - floor(t / m_period) * m_period;
+        s = size_t(p / slot_length());
+        if (s >= m_slots) s = m_slots - 1;
+        return p - s * slot_length();
+    }
+
+    //! @brief Whether slot `s` in the period containing `t` has to be listened.
+    bool needed(times_t t, size_t s) const {
+        if (s == m_slot or t - m_heard[s] <= stale_periods * m_period) return true;
+        using std::floor;
+        return m_discovery > 0 and size_t(floor(t / m_period)) % m_discovery == 0;
+    }
+
+    //! @brief The UID of the device.
+    device_t m_uid;
+    //! @brief The period of the schedule.
+    times_t m_period;
+    //! @brief The number of slots in a period.
+    size_t m_slots;
+    //! @brief The number of periods between discovery periods.
+    size_t m_discovery;
+    //! @brief The transmit slot of the device.
+    size_t m_slot;
+    //! @brief Last global time a neighbour has been heard in each slot.
+    times_t m_heard[max_slots];
+};
+
+
+}
+
+
+}
+
+#endif // FCPP_MIOSIX_TDMA_H_
@@ -0,0 +1,58 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "radio_trace.hpp"
+
+
+//! @brief Decodes the radio trace dumps in a console log (from a file or the standard input) as text or CSV (with `-c`).
+int main(int argc, char** argv) {
+    using namespace fcpp::os;
+
+    bool csv = false;
+    char const* file = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "-c") csv = true;
+        else file = argv[i];
+    }
+    std::ifstream fin;
+    if (file) {
+        fin.open(file);
+        if (not fin) {
+            std::cerr << "cannot open " << file << std::endl;
+            return 1;
+        }
+    }
+    std::istream& in = file ? fin : std::cin;
+    if (csv) std::cout << "dump,time,event,size,rssi,peer" << std::endl;
+    int dump = 0;
+    int64_t start = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 7, "#trace ") == 0) {
+            std::stringstream ss(line.substr(7));
+            uint32_t total;
+            size_t count;
+            ss >> total >> count;
+            ++dump;
+            start = 0;
+            if (not csv) std::cout << "---- dump " << dump << ": " << count << " events (" << total - count << " overwritten)" << std::endl;
+            continue;
+        }
+        trace_record r;
+        if (line.compare(0, 3, "#T ") != 0 or not parse_trace_record(line.substr(3), r)) continue;
+        if (start == 0) start = r.time;
+        if (csv) {
+            std::cout << dump << "," << r.time << "," << trace_event_name(r.event) << "," << r.size << "," << int(r.rssi) << "," << r.peer << std::endl;
+            continue;
+        }
+        std::cout << "+" << (r.time - start) / 1000 << "us\t" << trace_event_name(r.event) << "\t" << r.size << " bytes";
+        if (r.rssi != 0) std::cout << "\t" << int(r.rssi) << " dBm";
+        if (r.peer != 0) std::cout << "\tdevice " << r.peer;
+        std::cout << std::endl;
+    }
+    return 0;
+}